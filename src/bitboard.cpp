@@ -44,6 +44,10 @@ Move::Move(const char _from, const char _to, const bool _is_promo, const char _p
     promo = _promo;
 }
 
+bool Move::operator==(const Move& other) const {
+    return (from == other.from) && (to == other.to) && (is_promo == other.is_promo) && (promo == other.promo);
+}
+
 
 Position::Position() {
     wp = Bitboard::EMPTY;
@@ -64,6 +68,7 @@ Position::Position() {
     ep = false;
     ep_square = 0;
     move_cnt = 0;
+    draw50 = 0;
 }
 
 Position::Position(const U64 _wp, const U64 _wn, const U64 _wb, const U64 _wr, const U64 _wq, const U64 _wk,
@@ -257,6 +262,22 @@ namespace Bitboard {
         else return " ";
     }
 
+    char piece_type(const Position& pos, const char& loc) {
+        if (bit(pos.wp|pos.bp, loc)) return 0;
+        else if (bit(pos.wn|pos.bn, loc)) return 1;
+        else if (bit(pos.wb|pos.bb, loc)) return 2;
+        else if (bit(pos.wr|pos.br, loc)) return 3;
+        else if (bit(pos.wq|pos.bq, loc)) return 4;
+        else if (bit(pos.wk|pos.bk, loc)) return 5;
+        else return 6;
+    }
+
+    bool is_capture(const Position& pos, const Move& move) {
+        if (bit(get_all(pos), move.to)) return true;
+        // En passant: pawn moving diagonally onto the ep square.
+        return pos.ep && (move.to == pos.ep_square) && bit(pos.wp|pos.bp, move.from) && ((move.to&7) != (move.from&7));
+    }
+
     string board_str(const U64& board, const string on, const string off) {
         vector<string> rows;
         string repr = "";
@@ -355,7 +376,7 @@ namespace Bitboard {
         else str += "-";
         str += " ";
 
-        str += std::to_string(pos.draw50/2);
+        str += std::to_string(pos.draw50);
         str += " ";
         str += std::to_string(pos.move_cnt/2 + 1);
 
@@ -413,8 +434,8 @@ namespace Bitboard {
             pos.ep = true;
             pos.ep_square = ((std::stoi(string(1, parts[3][1]))-1)<<3) + (parts[3][0] - 97);
         }
-        pos.draw50 = std::stoi(parts[4])*2;
-        pos.move_cnt = std::stoi(parts[4])*2-1;
+        pos.draw50 = std::stoi(parts[4]);
+        pos.move_cnt = 2*(std::stoi(parts[5])-1) + (pos.turn ? 0 : 1);   // Plies, fen() prints move_cnt/2+1
 
         return pos;
     }
@@ -519,6 +540,61 @@ namespace Bitboard {
         }
     }
 
+    U64 attackers(const Position& pos, const char& sq, const U64& occupied) {
+        /*
+        Calculates a bitboard of pieces (both sides) attacking a square.
+        pos: Position.
+        sq: Target square.
+        occupied: Pieces still on the board. Sliders see through anything not in occupied,
+            which is how x-ray attackers are discovered during exchanges.
+        return: Bitboard of attackers, masked by occupied.
+        */
+        const char x = (sq&7), y = (sq>>3);
+        const U64 diag = pos.wb | pos.bb | pos.wq | pos.bq;
+        const U64 orth = pos.wr | pos.br | pos.wq | pos.bq;
+        U64 board = EMPTY;
+
+        // Pawns: white pawns attack from below, black pawns from above.
+        for (const auto& dx: {-1, 1}) {
+            if (in_board(x+dx, y-1) && bit(pos.wp, ((y-1)<<3) + x+dx)) set_bit(board, ((y-1)<<3) + x+dx);
+            if (in_board(x+dx, y+1) && bit(pos.bp, ((y+1)<<3) + x+dx)) set_bit(board, ((y+1)<<3) + x+dx);
+        }
+        for (const auto& dir: DIR_N) {
+            const char nx = x+dir[0], ny = y+dir[1];
+            if (in_board(nx, ny) && bit(pos.wn|pos.bn, (ny<<3) + nx)) set_bit(board, (ny<<3) + nx);
+        }
+        for (const auto& dir: DIR_K) {
+            const char nx = x+dir[0], ny = y+dir[1];
+            if (in_board(nx, ny) && bit(pos.wk|pos.bk, (ny<<3) + nx)) set_bit(board, (ny<<3) + nx);
+        }
+        for (const auto& dir: DIR_B) {
+            char cx = x, cy = y;
+            while (true) {
+                cx += dir[0];
+                cy += dir[1];
+                if (!in_board(cx, cy)) break;
+                const char loc = (cy<<3) + cx;
+                if (!bit(occupied, loc)) continue;
+                if (bit(diag, loc)) set_bit(board, loc);
+                break;
+            }
+        }
+        for (const auto& dir: DIR_R) {
+            char cx = x, cy = y;
+            while (true) {
+                cx += dir[0];
+                cy += dir[1];
+                if (!in_board(cx, cy)) break;
+                const char loc = (cy<<3) + cx;
+                if (!bit(occupied, loc)) continue;
+                if (bit(orth, loc)) set_bit(board, loc);
+                break;
+            }
+        }
+
+        return board & occupied;
+    }
+
     char num_attacks(const vector<Move>& moves, const Location& sq) {
         // Returns the number of attackers attacking a certain square.
 
@@ -977,8 +1053,9 @@ namespace Bitboard {
         }
     }
 
-    vector<Move> legal_moves(const Position pos, const U64& attacks) {
+    void legal_moves(Move* moves, int& movecnt, const Position& pos, const U64& attacks) {
         // Pass in attacks from opponent.
+        // Writes into a caller owned buffer of at least MAX_MOVES, so the search doesn't allocate.
         // Current and opponent pieces and sides
         U64 SP, SN, SB, SR, SQ, SK, OP, ON, OB, OR, OQ, OK;
         if (pos.turn) {
@@ -1016,14 +1093,19 @@ namespace Bitboard {
         const U64 checking_pieces = checkers(k_pos, OP, ON, OB, OR, OQ, OK, SAME, attacks, pos.turn);
         const char num_checkers = popcnt(checking_pieces);
 
-        int movecnt = 0;
-        Move moves[MAX_MOVES];
+        movecnt = 0;
         if (num_checkers == 0) {
             no_check_moves(moves, movecnt, pos, SP, SN, SB, SR, SQ, SK, OP, ON, OB, OR, OQ, OK, SAME, OPPONENT, ALL, k_pos, checking_pieces);
         } else if (num_checkers == 1) {
             single_check_moves(moves, movecnt, pos, SP, SN, SB, SR, SQ, SK, OP, ON, OB, OR, OQ, OK, SAME, OPPONENT, ALL, k_pos, checking_pieces);
         }
         king_moves(moves, movecnt, k_pos, pos.castling, pos.turn, SAME, ALL, attacks);
+    }
+
+    vector<Move> legal_moves(const Position pos, const U64& attacks) {
+        int movecnt;
+        Move moves[MAX_MOVES];
+        legal_moves(moves, movecnt, pos, attacks);
         return vector<Move>(moves, moves+movecnt);
     }
 
@@ -1069,6 +1151,7 @@ namespace Bitboard {
         U64* to_board = pointers[0];
         const bool is_king = bit(pos.wk|pos.bk, move.from);
         const bool is_pawn = bit(pos.wp|pos.bp, move.from);
+        const bool is_capture = bit(get_all(pos), move.to);   // Before the target square is cleared
 
         // Find to_board and set bits.
         for (UCH i = 0; i < 12; i++) {
@@ -1081,7 +1164,7 @@ namespace Bitboard {
         }
 
         // 50 move rule
-        if (is_pawn || bit(get_all(pos), move.to)) pos.draw50 = 0;
+        if (is_pawn || is_capture) pos.draw50 = 0;
         else pos.draw50++;
 
         if (move.is_promo) {
@@ -1167,4 +1250,13 @@ namespace Bitboard {
     Position push(Position pos, const string& uci) {
         return push(pos, parse_uci(uci));
     }
+
+    Position push_null(Position pos) {
+        // Passes the turn without moving. Used for null move pruning.
+        pos.ep = false;
+        pos.draw50++;
+        pos.turn = !pos.turn;
+        pos.move_cnt++;
+        return pos;
+    }
 }
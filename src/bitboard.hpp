@@ -35,6 +35,7 @@ typedef unsigned char       UCH;
 struct Move {
     Move();
     Move(const char, const char, const bool=false, const char=0);
+    bool operator==(const Move&) const;
 
     UCH from;
     UCH to;
@@ -53,7 +54,6 @@ struct Position {
     UCH ep_square;
     bool ep;
 
-    Position* parent;
     float eval;
     int move_cnt;
     UCH draw50;
@@ -71,6 +71,7 @@ struct Location {
 
 namespace Bitboard {
     // Promotion piece format: 0=knight, 1=bishop, 2=rook, 3=queen
+    // Piece type format: 0=pawn, 1=knight, 2=bishop, 3=rook, 4=queen, 5=king, 6=empty
 
     constexpr U64 EMPTY = 0ULL;
     constexpr U64 FULL = 18446744073709551615ULL;
@@ -139,6 +140,8 @@ namespace Bitboard {
     Location first_bit(const U64&);
 
     string piece_at(const Position&, const char&);
+    char piece_type(const Position&, const char&);
+    bool is_capture(const Position&, const Move&);
     U64 color(const Position&, const bool&);
     string board_str(const U64&, const string="X", const string="-");
     string board_str(const Position&);
@@ -150,6 +153,7 @@ namespace Bitboard {
 
     U64 attacked(const U64&, const U64&, const U64&, const U64&, const U64&, const U64&, const U64&, const bool&);
     U64 attacked(const Position&, const bool&);
+    U64 attackers(const Position&, const char&, const U64&);
     char num_attacks(const vector<Move>&, const Location&);
     U64 pinned(const U64&, const U64&, const U64&, const U64&, const U64&, const U64&, const U64&, const U64&, const U64&);
     U64 checkers(const Location&, const U64&, const U64&, const U64&, const U64&, const U64&, const U64&, const U64&, const U64&, const bool&);
@@ -160,6 +164,7 @@ namespace Bitboard {
     void no_check_moves(Move*, int&, const Position&, const U64&, const U64&, const U64&, const U64&,
         const U64&, const U64&, const U64&, const U64&, const U64&, const U64&, const U64&, const U64&,
         const U64&, const U64&, const U64&, const Location&, const U64&);
+    void legal_moves(Move*, int&, const Position&, const U64&);
     vector<Move> legal_moves(Position, const U64&);
 
     U64 get_white(const Position&);
@@ -169,4 +174,5 @@ namespace Bitboard {
     Position startpos();
     Position push(Position, const Move&);
     Position push(Position, const string&);
+    Position push_null(Position);
 }
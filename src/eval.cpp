@@ -20,6 +20,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <algorithm>
 #include "bitboard.hpp"
 #include "options.hpp"
 #include "eval.hpp"
@@ -105,6 +106,68 @@ namespace Eval {
         return value;
     }
 
+    float non_pawn_mat(const Position& pos, const bool& side) {
+        if (side) return popcnt(pos.wn)*3 + popcnt(pos.wb)*3 + popcnt(pos.wr)*5 + popcnt(pos.wq)*9;
+        else      return popcnt(pos.bn)*3 + popcnt(pos.bb)*3 + popcnt(pos.br)*5 + popcnt(pos.bq)*9;
+    }
+
+
+    int see(const Position& pos, const Move& move) {
+        /*
+        Static exchange evaluation.
+        Plays out all captures on move.to, each side always recapturing with its least valuable
+        attacker, and either side may stop capturing when it is ahead.
+        return: Material gain (centipawns) for the side to move. Negative means the move loses material.
+        */
+        const U64* pieces[2][6] = {
+            {&pos.bp, &pos.bn, &pos.bb, &pos.br, &pos.bq, &pos.bk},
+            {&pos.wp, &pos.wn, &pos.wb, &pos.wr, &pos.wq, &pos.wk},
+        };
+        const U64 white = Bitboard::get_white(pos);
+        const U64 black = Bitboard::get_black(pos);
+        U64 occupied = white | black;
+
+        int gain[32];
+        int d = 0;
+        int attacker = Bitboard::piece_type(pos, move.from);
+        const int victim = Bitboard::piece_type(pos, move.to);
+
+        gain[0] = SEE_VALUES[victim];
+        if (attacker == 0 && victim == 6 && pos.ep && move.to == pos.ep_square && (move.to&7) != (move.from&7)) {
+            gain[0] = SEE_VALUES[0];
+            Bitboard::unset_bit(occupied, pos.turn ? move.to-8 : move.to+8);
+        }
+        if (move.is_promo) {
+            attacker = move.promo + 1;
+            gain[0] += SEE_VALUES[attacker] - SEE_VALUES[0];
+        }
+        Bitboard::unset_bit(occupied, move.from);
+
+        bool side = pos.turn;
+        while (d < 31) {
+            side = !side;
+            const U64 attackers = Bitboard::attackers(pos, move.to, occupied) & (side ? white : black);
+            if (attackers == Bitboard::EMPTY) break;
+
+            // Least valuable attacker
+            int next = 0;
+            U64 from = Bitboard::EMPTY;
+            for (; next < 6; next++) {
+                from = attackers & *pieces[side][next];
+                if (from != Bitboard::EMPTY) break;
+            }
+
+            d++;
+            gain[d] = SEE_VALUES[attacker] - gain[d-1];
+
+            occupied ^= from & (~from+1);
+            attacker = next;
+        }
+        for (; d > 0; d--) gain[d-1] = -std::max(-gain[d-1], gain[d]);
+
+        return gain[0];
+    }
+
 
     float phase(const Position& pos) {
         // 1 = full middlegame, 0 = full endgame.
@@ -323,17 +386,23 @@ namespace Eval {
     }
 
 
-    float eval(const Options& options, const Position& pos, const vector<Move>& moves, const int& depth, const U64& o_attacks,
+    int eval(const Options& options, const Position& pos, const vector<Move>& moves, const int& depth, const U64& o_attacks,
+            const bool print) {
+        return eval(options, pos, (int)moves.size(), depth, o_attacks, print);
+    }
+
+    int eval(const Options& options, const Position& pos, const int& movecnt, const int& depth, const U64& o_attacks,
             const bool print) {
-        if (moves.empty()) {
+        // movecnt is the number of legal moves, only used to detect mate and stalemate.
+        if (movecnt == 0) {
             bool checked = false;
             if      ( pos.turn && ((o_attacks & pos.wk) != 0)) checked = true;
             else if (!pos.turn && ((o_attacks & pos.bk) != 0)) checked = true;
             if (checked) {
                 // Increment value by depth to encourage sooner mate.
                 // The larger depth is, the closer it is to the leaf nodes.
-                if (pos.turn) return Search::MIN + depth;  // Mate by black
-                else return Search::MAX - depth;           // Mate by white
+                if (pos.turn) return -Search::MATE + depth;  // Mate by black
+                else return Search::MATE - depth;            // Mate by white
             }
             return 0;
         }
@@ -370,6 +439,7 @@ namespace Eval {
             cout << "          Final | " << mat+imbalance << endl;
         }
 
-        return mat + imbalance;
+        // Centipawns, white relative. Terms are weighted in pawns above and converted once here.
+        return (int)(100 * (mat+imbalance));
     }
 }
@@ -36,6 +36,7 @@ namespace Eval {
     constexpr int ENDGAME_LIM = 20;
     constexpr U64 INNER_CENTER = 103481868288ULL;
     constexpr U64 OUTER_CENTER = 66125924401152ULL;
+    constexpr int SEE_VALUES[7] = {100, 300, 300, 500, 900, 20000, 0};  // Centipawns, indexed by piece type.
 
     void init();
     char center_dist(const char&);
@@ -43,6 +44,9 @@ namespace Eval {
     float material(const Position&);
     float total_mat(const Position&);
     float non_pawn_mat(const Position&);
+    float non_pawn_mat(const Position&, const bool&);
+    int see(const Position&, const Move&);
 
-    float eval(const Options&, const Position&, const vector<Move>&, const int&, const U64&, const bool=false);
+    int eval(const Options&, const Position&, const vector<Move>&, const int&, const U64&, const bool=false);
+    int eval(const Options&, const Position&, const int&, const int&, const U64&, const bool=false);
 }
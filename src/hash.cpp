@@ -22,7 +22,6 @@
 #include <string>
 #include "hash.hpp"
 #include "bitboard.hpp"
-#include "utils.hpp"
 
 using std::cin;
 using std::cout;
@@ -32,54 +31,56 @@ using std::string;
 
 
 namespace Hash {
-    U64 piece_bits[101][64][12];
+    U64 piece_bits[64][12];
     U64 ep_square[64];
     U64 turn[2];
-    U64 ep[2];
-    U64 castling[15];
+    U64 castling[16];
+
+    U64 rand_key() {
+        // xorshift64*. randull() is unusable for keys: its low bits are always the same.
+        static U64 state = 1070372;
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
 
     void init() {
-        for (UCH i = 0; i < 101; i++) {
-            for (UCH j = 0; j < 64; j++) {
-                for (UCH k = 0; k < 12; k++) {
-                    piece_bits[i][j][k] = randull();
-                }
+        for (UCH i = 0; i < 64; i++) {
+            for (UCH j = 0; j < 12; j++) {
+                piece_bits[i][j] = rand_key();
             }
         }
         for (UCH i = 0; i < 64; i++) {
-            ep_square[i] = randull();
+            ep_square[i] = rand_key();
         }
-        for (UCH i = 0; i < 15; i++) {
-            castling[i] = randull();
+        for (UCH i = 0; i < 16; i++) {
+            castling[i] = rand_key();
         }
-        turn[0] = randull();
-        turn[1] = randull();
-        ep[0] = randull();
-        ep[1] = randull();
+        turn[0] = rand_key();
+        turn[1] = rand_key();
     }
 
     U64 hash(const Position& pos) {
-        const U64 kings = pos.wk | pos.bk;
-        const UCH idx = kings % 101;
+        // Plain Zobrist key, so a reversible move always changes it by move_key().
+        const U64 boards[12] = {pos.wp, pos.wn, pos.wb, pos.wr, pos.wq, pos.wk, pos.bp, pos.bn, pos.bb, pos.br, pos.bq, pos.bk};
         U64 value = 0;
-        for (UCH i = 0; i < 64; i++) {
-            if      (Bitboard::bit(pos.wp, i)) value ^= piece_bits[idx][i][0];
-            else if (Bitboard::bit(pos.wn, i)) value ^= piece_bits[idx][i][1];
-            else if (Bitboard::bit(pos.wb, i)) value ^= piece_bits[idx][i][2];
-            else if (Bitboard::bit(pos.wr, i)) value ^= piece_bits[idx][i][3];
-            else if (Bitboard::bit(pos.wq, i)) value ^= piece_bits[idx][i][4];
-            else if (Bitboard::bit(pos.wk, i)) value ^= piece_bits[idx][i][5];
-            else if (Bitboard::bit(pos.bp, i)) value ^= piece_bits[idx][i][6];
-            else if (Bitboard::bit(pos.bn, i)) value ^= piece_bits[idx][i][7];
-            else if (Bitboard::bit(pos.bb, i)) value ^= piece_bits[idx][i][8];
-            else if (Bitboard::bit(pos.br, i)) value ^= piece_bits[idx][i][9];
-            else if (Bitboard::bit(pos.bq, i)) value ^= piece_bits[idx][i][10];
-            else if (Bitboard::bit(pos.bk, i)) value ^= piece_bits[idx][i][11];
+        for (UCH i = 0; i < 12; i++) {
+            U64 board = boards[i];
+            while (board != 0) {
+                const U64 lsb = board & (~board + 1);
+                value ^= piece_bits[(int)Bitboard::first_bit_char(lsb)][i];
+                board ^= lsb;
+            }
         }
         value ^= turn[pos.turn];
-        value ^= ep[pos.ep];
         value ^= castling[pos.castling];
-        value ^= ep_square[pos.ep_square];
+        if (pos.ep) value ^= ep_square[pos.ep_square];
         return value;
     }
+
+    U64 move_key(const int& piece, const int& from, const int& to) {
+        // Difference between the keys before and after piece moves from -> to without capturing.
+        return piece_bits[from][piece] ^ piece_bits[to][piece] ^ turn[0] ^ turn[1];
+    }
 }
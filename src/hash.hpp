@@ -33,4 +33,5 @@ using std::string;
 namespace Hash {
     void init();
     U64 hash(const Position&);
+    U64 move_key(const int&, const int&, const int&);
 }
@@ -0,0 +1,176 @@
+//
+//  Megalodon
+//  UCI chess engine
+//  Copyright the Megalodon developers
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <atomic>
+#include "bitboard.hpp"
+#include "search.hpp"
+#include "mate.hpp"
+#include "output.hpp"
+
+using std::cin;
+using std::cout;
+using std::endl;
+using std::vector;
+using std::string;
+
+
+namespace Mate {
+    /*
+    Checks-only mate search: the attacker only plays checks, the defender tries every reply.
+    Checks are ordered by the number of replies they leave, fewest first.
+    Much narrower than the main search, but it can't find mates that need a quiet move.
+    */
+
+    struct MateState {
+        MateState(const TimeManager& _tm, const std::atomic<bool>& _searching) : tm(_tm), searching(_searching) {
+            nodes = 0;
+            next_check = 0;
+            stopped = false;
+        }
+
+        const TimeManager& tm;
+        const std::atomic<bool>& searching;
+        U64 nodes;
+        U64 next_check;
+        bool stopped;
+        Move pv[Search::MAX_PLY][Search::MAX_PLY];
+        int pv_len[Search::MAX_PLY];
+    };
+
+    void update_pv(MateState& state, const Move& move, const int& ply) {
+        state.pv[ply][0] = move;
+        for (int i = 0; i < state.pv_len[ply+1]; i++) state.pv[ply][i+1] = state.pv[ply+1][i];
+        state.pv_len[ply] = state.pv_len[ply+1] + 1;
+    }
+
+    bool gives_check(const Position& pos, U64& o_attacks) {
+        // pos is after the move. o_attacks is set to the attacks on the side to move.
+        o_attacks = Bitboard::attacked(pos, !pos.turn);
+        return (o_attacks & (pos.turn ? pos.wk : pos.bk)) != 0;
+    }
+
+    int defend(MateState&, const Position&, const int&, const int&);
+
+    int attack(MateState& state, const Position& pos, const int& moves_left, const int& ply) {
+        /*
+        Side to move is the attacker.
+        return: Moves to mate if a mate in at most moves_left is found, otherwise 0.
+        */
+        state.nodes++;
+        state.pv_len[ply] = 0;
+        if (state.nodes >= state.next_check) {
+            state.next_check = state.nodes + Search::TIME_CHECK_NODES;
+            if (!state.searching || state.tm.out_of_time() || state.tm.out_of_nodes(state.nodes)) state.stopped = true;
+        }
+        if (state.stopped) return 0;
+
+        Move moves[Bitboard::MAX_MOVES];
+        int num_moves;
+        Bitboard::legal_moves(moves, num_moves, pos, Bitboard::attacked(pos, !pos.turn));
+
+        // Keep the checks, counting the replies to each.
+        Move checks[Bitboard::MAX_MOVES];
+        int replies[Bitboard::MAX_MOVES];
+        int num_checks = 0;
+        for (int i = 0; i < num_moves; i++) {
+            const Position new_pos = Bitboard::push(pos, moves[i]);
+            U64 o_attacks;
+            if (!gives_check(new_pos, o_attacks)) continue;
+
+            Move buf[Bitboard::MAX_MOVES];
+            int num_replies;
+            Bitboard::legal_moves(buf, num_replies, new_pos, o_attacks);
+            if (num_replies == 0) {
+                state.pv_len[ply+1] = 0;
+                update_pv(state, moves[i], ply);
+                return 1;
+            }
+
+            // Insertion by reply count
+            int j = num_checks++;
+            for (; (j > 0) && (replies[j-1] > num_replies); j--) {
+                checks[j] = checks[j-1];
+                replies[j] = replies[j-1];
+            }
+            checks[j] = moves[i];
+            replies[j] = num_replies;
+        }
+        if ((moves_left <= 1) || (ply+2 >= Search::MAX_PLY)) return 0;
+
+        for (int i = 0; i < num_checks; i++) {
+            const int result = defend(state, Bitboard::push(pos, checks[i]), moves_left-1, ply+1);
+            if (state.stopped) return 0;
+            if (result > 0) {
+                update_pv(state, checks[i], ply);
+                return result + 1;
+            }
+        }
+        return 0;
+    }
+
+    int defend(MateState& state, const Position& pos, const int& moves_left, const int& ply) {
+        /*
+        Side to move is in check and has a reply.
+        return: Moves to mate against the longest defence if every reply is mated in moves_left, otherwise 0.
+        */
+        state.nodes++;
+        state.pv_len[ply] = 0;
+
+        Move moves[Bitboard::MAX_MOVES];
+        int num_moves;
+        Bitboard::legal_moves(moves, num_moves, pos, Bitboard::attacked(pos, !pos.turn));
+
+        int longest = 0;
+        for (int i = 0; i < num_moves; i++) {
+            const int result = attack(state, Bitboard::push(pos, moves[i]), moves_left, ply+1);
+            if (state.stopped || (result == 0)) return 0;
+            if (result > longest) {
+                longest = result;
+                update_pv(state, moves[i], ply);
+            }
+        }
+        return longest;
+    }
+
+    SearchInfo search(const Position& pos, const int& moves, const TimeManager& tm, const std::atomic<bool>& searching) {
+        /*
+        Looks for a mate in at most moves moves, trying each length in turn so the shortest is found.
+        return: The mate line, or a SearchInfo with an empty pv if none was found.
+        */
+        MateState state(tm, searching);
+        SearchInfo result;
+        for (int n = 1; n <= std::min(moves, MAX_MATE_MOVES); n++) {
+            const int found = attack(state, pos, n, 0);
+            if (state.stopped) break;
+            if (found > 0) {
+                const double elapse = tm.elapsed();
+                const vector<Move> pv(state.pv[0], state.pv[0]+state.pv_len[0]);
+                result = SearchInfo(2*found-1, state.pv_len[0], Search::MATE-(2*found-1), state.nodes,
+                    state.nodes/(elapse+0.001), 0, elapse, pv, -Search::INF, Search::INF, true);
+                Output::line(result.as_string());
+                break;
+            }
+        }
+        return result;
+    }
+}
@@ -20,9 +20,10 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <algorithm>
 #include "options.hpp"
 
-#define HASH_FACTOR  348000
+#define HASH_FACTOR  (1048576 / sizeof(Transposition))
 
 using std::cin;
 using std::cout;
@@ -46,6 +47,19 @@ Options::Options() {
     EvalQueens     = 1;
     EvalKings      = 1;
 
+    RFPMargin      = 80;
+    FutilityMargin = 120;
+    RazorMargin    = 300;
+    IID            = true;
+    IIR            = true;
+
+    MoveOverhead   = 30;
+    Ponder         = false;
+    MultiPV        = 1;
+    InfoInterval   = 1000;
+
+    debug          = false;
+
     hash_table = new Transposition[16];
     set_hash();
 }
@@ -62,3 +76,13 @@ void Options::clear_hash() {
         hash_table[i].depth = 0;
     }
 }
+
+int Options::hashfull() const {
+    // Permille of used entries, sampled from the start of the table. The table persists across searches.
+    const U64 sample = std::min(hash_size, (U64)1000);
+    U64 used = 0;
+    for (U64 i = 0; i < sample; i++) {
+        if (hash_table[i].depth > 0) used++;
+    }
+    return 1000 * used / sample;
+}
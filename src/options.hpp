@@ -33,9 +33,12 @@ using std::string;
 struct Transposition {
     Transposition();
 
+    unsigned int key;   // Upper 32 bits of hash, verifies the entry belongs to the position
+    short score;        // Centipawns, mate scores relative to this node
     char depth;
     char from;  // First six bits = square, last two = promo piece
     char to;    // First six bits = square, seventh = is_promo
+    char bound; // Search::BOUND_EXACT, BOUND_LOWER or BOUND_UPPER
 };
 
 class Options {
@@ -49,15 +52,28 @@ EvalKnights: type=spin, default=100, min=0, max=1000, weight (percent) of knight
 EvalRooks: type=spin, default=100, min=0, max=1000, weight (percent) of rook eval.
 EvalQueens: type=spin, default=100, min=0, max=1000, weight (percent) of queen eval.
 EvalKings: type=spin, default=100, min=0, max=1000, weight (percent) of king eval.
+
+RFPMargin: type=spin, default=80, min=0, max=1000, reverse futility pruning margin (centipawns per ply).
+FutilityMargin: type=spin, default=120, min=0, max=1000, futility pruning margin (centipawns per ply).
+RazorMargin: type=spin, default=300, min=0, max=2000, razoring margin (centipawns per ply).
+IID: type=check, default=true, internal iterative deepening at PV nodes without a hash move.
+IIR: type=check, default=true, internal iterative reduction at non-PV nodes without a hash move.
+
+MoveOverhead: type=spin, default=30, min=0, max=5000, time (milliseconds) reserved per move for communication lag.
+MultiPV: type=spin, default=1, min=1, max=256, number of best lines reported.
+Ponder: type=check, default=false, the GUI may send go ponder. Searching is the same either way.
+InfoInterval: type=spin, default=1000, min=0, max=60000, time (milliseconds) between progress info lines during an iteration, 0 disables them.
 */
 
 public:
     Options();
     void set_hash();
     void clear_hash();
+    int hashfull() const;
 
     Transposition* hash_table;
     U64 hash_size;
+    bool debug;     // Set by the debug command, enables search statistics
 
     int Hash;
 
@@ -68,4 +84,15 @@ public:
     float EvalRooks;
     float EvalQueens;
     float EvalKings;
+
+    int RFPMargin;
+    int FutilityMargin;
+    int RazorMargin;
+    bool IID;
+    bool IIR;
+
+    int MoveOverhead;
+    bool Ponder;
+    int MultiPV;
+    int InfoInterval;
 };
@@ -0,0 +1,90 @@
+//
+//  Megalodon
+//  UCI chess engine
+//  Copyright the Megalodon developers
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "output.hpp"
+
+using std::string;
+
+
+namespace Output {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;       // Signals the writer: new lines or quit
+    std::condition_variable idle_cv;  // Signals flush(): everything pending was written
+    string pending;                   // Lines not handed to the writer yet
+    bool writing = false;
+    bool quit = false;
+
+    void writer() {
+        // Swaps the pending buffer for an empty one, then writes it with a single fwrite.
+        string batch;
+        batch.reserve(BUFFER_SIZE);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, []() { return !pending.empty() || quit; });
+            if (pending.empty()) break;
+
+            batch.swap(pending);
+            writing = true;
+            lock.unlock();
+            fwrite(batch.data(), 1, batch.size(), stdout);
+            fflush(stdout);
+            batch.clear();
+            lock.lock();
+            writing = false;
+            idle_cv.notify_all();
+        }
+    }
+
+    void start() {
+        pending.reserve(BUFFER_SIZE);
+        quit = false;
+        thread = std::thread(writer);
+    }
+
+    void stop() {
+        // Writes what is pending, then ends the writer.
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        cv.notify_all();
+        if (thread.joinable()) thread.join();
+    }
+
+    void line(const string& str) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending += str;
+            pending += '\n';
+        }
+        cv.notify_one();
+    }
+
+    void flush() {
+        // Blocks until every line queued before the call was written.
+        std::unique_lock<std::mutex> lock(mutex);
+        idle_cv.wait(lock, []() { return pending.empty() && !writing; });
+    }
+}
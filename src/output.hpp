@@ -0,0 +1,38 @@
+//
+//  Megalodon
+//  UCI chess engine
+//  Copyright the Megalodon developers
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <string>
+
+using std::string;
+
+namespace Output {
+    /*
+    UCI output written by a dedicated thread. Lines are appended to a buffer and the thread
+    writes everything pending at once, so searching threads never wait on a slow pipe.
+    Commands that only print debugging output (d, eval, perft ...) still use cout directly.
+    */
+    constexpr int BUFFER_SIZE = 1 << 16;   // Initial capacity of the buffers, bytes
+
+    void start();
+    void stop();
+    void line(const string&);
+    void flush();
+}
@@ -65,4 +65,20 @@ namespace Perft {
         for (auto i = 0; i < knodes*1000; i++) Bitboard::push(pos, move);
         return get_time() - start;
     }
+
+    double see_perft(const Position& pos, const int& knodes) {
+        // Cycles through captures of the position (all moves if there are none). -1 without legal moves.
+        const vector<Move> legal = Bitboard::legal_moves(pos, Bitboard::attacked(pos, !pos.turn));
+        vector<Move> moves;
+        for (const auto& move: legal) {
+            if (Bitboard::is_capture(pos, move)) moves.push_back(move);
+        }
+        if (moves.empty()) moves = legal;
+        if (moves.empty()) return -1;   // Checkmate or stalemate, nothing to evaluate
+
+        const double start = get_time();
+        volatile int total = 0;
+        for (auto i = 0; i < knodes*1000; i++) total += Eval::see(pos, moves[i%moves.size()]);
+        return get_time() - start;
+    }
 }
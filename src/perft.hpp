@@ -35,4 +35,5 @@ namespace Perft {
     double hash_perft(const Position&, const int&);
     double eval_perft(const Options&, const Position&, const int&);
     double push_perft(const Position&, const int&);
+    double see_perft(const Position&, const int&);
 }
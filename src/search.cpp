@@ -21,6 +21,10 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <cstdio>
+#include <chrono>
 #include "bitboard.hpp"
 #include "search.hpp"
 #include "eval.hpp"
@@ -28,6 +32,8 @@
 #include "utils.hpp"
 #include "hash.hpp"
 #include "endgame.hpp"
+#include "debug.hpp"
+#include "output.hpp"
 
 using std::cin;
 using std::cout;
@@ -36,12 +42,221 @@ using std::vector;
 using std::string;
 
 
+StackEntry::StackEntry() {
+    num_moves = 0;
+    quiet_cnt = 0;
+    static_eval = 0;
+    key = 0;
+    plies_from_null = 0;
+    killers[0] = Move(0, 0);
+    killers[1] = Move(0, 0);
+    move = Move(0, 0);
+    piece = 12;
+    cont_hist = nullptr;
+    null_move = false;
+    reduction = 0;
+}
+
+
+RootMove::RootMove(const Move& _move) {
+    move = _move;
+    score = -Search::INF;
+    nodes = 0;
+}
+
+
+SearchStats::SearchStats() {
+    cutoffs = 0;
+    first_cutoffs = 0;
+    reduced = 0;
+    reduction_sum = 0;
+    researches = 0;
+
+    enabled = false;
+    nodes = 0;
+    tt_probes = 0;
+    tt_hits = 0;
+    tt_cutoffs = 0;
+    qnodes = 0;
+    null_tries = 0;
+    null_cutoffs = 0;
+    movegen_time = 0;
+    eval_time = 0;
+    hash_time = 0;
+}
+
+void SearchStats::add(const SearchStats& other) {
+    cutoffs += other.cutoffs;
+    first_cutoffs += other.first_cutoffs;
+    reduced += other.reduced;
+    reduction_sum += other.reduction_sum;
+    researches += other.researches;
+
+    enabled = enabled || other.enabled;
+    nodes += other.nodes;
+    tt_probes += other.tt_probes;
+    tt_hits += other.tt_hits;
+    tt_cutoffs += other.tt_cutoffs;
+    qnodes += other.qnodes;
+    null_tries += other.null_tries;
+    null_cutoffs += other.null_cutoffs;
+    movegen_time += other.movegen_time;
+    eval_time += other.eval_time;
+    hash_time += other.hash_time;
+}
+
+string SearchStats::as_string() const {
+    // One "info string" line per group. Rates are percentages, zero when nothing was counted.
+    const auto rate = [](const U64& num, const U64& den) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%.1f%%", (den > 0) ? 100.0*num/den : 0.0);
+        return string(buf);
+    };
+    const auto fixed = [](const double& value, const int& digits) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.*f", digits, value);
+        return string(buf);
+    };
+
+    string str = "";
+    if (!enabled) str += "info string statistics are off, use debug on; only cutoffs and LMR were counted\n";
+    str += "info string nodes " + std::to_string(nodes) + " main " + std::to_string(nodes-qnodes) +
+        " quiescence " + std::to_string(qnodes) + " (" + rate(qnodes, nodes) + ")\n";
+    str += "info string tt probes " + std::to_string(tt_probes) + " hits " + rate(tt_hits, tt_probes) +
+        " cutoffs " + rate(tt_cutoffs, tt_probes) + "\n";
+    str += "info string beta cutoffs " + std::to_string(cutoffs) + " first move " + rate(first_cutoffs, cutoffs) + "\n";
+    str += "info string null move tries " + std::to_string(null_tries) + " cutoffs " + rate(null_cutoffs, null_tries) + "\n";
+    str += "info string lmr reduced " + std::to_string(reduced) + " average " +
+        fixed((reduced > 0) ? (double)reduction_sum/reduced : 0, 2) + " plies, kept " + rate(reduced-researches, reduced) + "\n";
+
+    // Effective branching factor: nodes of an iteration over nodes of the one before.
+    str += "info string branching";
+    for (unsigned int i = 1; i < iter_nodes.size(); i++) {
+        const U64 prev = (i > 1) ? iter_nodes[i-1] - iter_nodes[i-2] : iter_nodes[0];
+        const U64 curr = iter_nodes[i] - iter_nodes[i-1];
+        str += " d" + std::to_string(i+1) + " " + fixed((prev > 0) ? (double)curr/prev : 0, 2);
+    }
+    str += "\n";
+    str += "info string time movegen " + fixed(movegen_time, 3) + "s eval " + fixed(eval_time, 3) +
+        "s hash " + fixed(hash_time, 3) + "s";
+    return str;
+}
+
+
+Progress::Progress() {
+    nodes = 0;
+    depth = 0;
+    seldepth = 0;
+    hashfull = 0;
+    currmove = -1;
+    currmove_num = 0;
+    tm = nullptr;
+    interval = 0;
+    active = false;
+    quit = false;
+}
+
+void Progress::begin(const TimeManager* _tm, const int& _interval) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        nodes = 0;
+        depth = 0;
+        seldepth = 0;
+        hashfull = 0;
+        currmove = -1;
+        currmove_num = 0;
+        tm = _tm;
+        interval = _interval;
+        active = true;
+    }
+    cv.notify_all();
+}
+
+void Progress::finish() {
+    // Returns once the reporter stopped printing for this search.
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active = false;
+        tm = nullptr;
+    }
+    cv.notify_all();
+}
+
+void Progress::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    cv.notify_all();
+}
+
+
+ThreadData::ThreadData() {
+    stack = vector<StackEntry>(Search::MAX_PLY+3);
+    cont_history = vector<int>(12*64*12*64);
+    clear();
+}
+
+void ThreadData::clear() {
+    std::fill(stack.begin(), stack.end(), StackEntry());
+    for (int i = 0; i < Search::MAX_PLY+1; i++) pv_len[i] = 0;
+    for (int i = 0; i < 12; i++) {
+        for (int j = 0; j < 64; j++) countermoves[i][j] = Move(0, 0);
+    }
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 64; j++) {
+            for (int k = 0; k < 64; k++) history[i][j][k] = 0;
+        }
+    }
+    std::fill(cont_history.begin(), cont_history.end(), 0);
+    new_search();
+}
+
+void ThreadData::new_search() {
+    // Resets the state of a single search. The move ordering tables carry over to the next search.
+    game_keys.clear();
+    root_excluded.clear();
+    root_moves.clear();
+    nmp_min_ply = 0;
+    root_depth = 0;
+    nodes = 0;
+    next_check = 0;
+    seldepth = 0;
+    stopped = false;
+    stats = SearchStats();
+    stats_on = false;
+    progress = nullptr;
+}
+
+void ThreadData::age() {
+    // Called between iterations so older cutoffs count less than recent ones.
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 64; j++) {
+            for (int k = 0; k < 64; k++) history[i][j][k] /= 2;
+        }
+    }
+    for (auto& value: cont_history) value /= 2;
+}
+
+StackEntry& ThreadData::ss(const int& ply) {
+    // Offset by two so ss(-1) and ss(-2) are valid at the root.
+    return stack[ply+2];
+}
+
+int* ThreadData::cont_hist(const int& piece, const int& to) {
+    return cont_history.data() + (piece*64 + to) * 12*64;
+}
+
+
 SearchInfo::SearchInfo() {
+    multipv = 1;
+    score = 0;
 }
 
-SearchInfo::SearchInfo(const int& _depth, const int& _seldepth, const float& _score, const U64& _nodes, const int& _nps,
-        const int& _hashfull, const double& _time, const vector<Move>& _pv, const float& _alpha, const float& _beta,
+SearchInfo::SearchInfo(const int& _depth, const int& _seldepth, const int& _score, const U64& _nodes, const int& _nps,
+        const int& _hashfull, const double& _time, const vector<Move>& _pv, const int& _alpha, const int& _beta,
         const bool& _full) {
+    multipv = 1;
     depth = _depth;
     seldepth = _seldepth;
     score = _score;
@@ -55,19 +270,21 @@ SearchInfo::SearchInfo(const int& _depth, const int& _seldepth, const float& _sc
     full = _full;
 }
 
-string SearchInfo::as_string() {
-    string str = "";
+string SearchInfo::as_string() const {
+    string str;
+    str.reserve(256 + 6*pv.size());
     str += "info depth " + std::to_string(depth) + " seldepth " + std::to_string(seldepth);
-    str += " multipv 1 score ";
+    str += " multipv " + std::to_string(multipv) + " score ";
     if (is_mate()) {
         str += "mate ";
-        char moves;
-        if (score < 0) moves = (score-Search::MIN+1) / 2;
-        else           moves = (Search::MAX-score+1) / 2;
+        // Score is MATE minus distance to mate in plies
+        int moves;
+        if (score < 0) moves = -(Search::MATE+score) / 2;
+        else           moves = (Search::MATE-score+1) / 2;
         str += std::to_string(moves);
     } else {
         str += "cp ";
-        str += std::to_string((int)(100*score));
+        str += std::to_string(score);
     }
     str += " nodes " + std::to_string(nodes) + " nps " + std::to_string(nps);
     str += " hashfull " + std::to_string(hashfull);
@@ -77,98 +294,695 @@ string SearchInfo::as_string() {
     return str;
 }
 
-bool SearchInfo::is_mate() {
-    return !(Search::MATE_BOUND_MIN <= score && score <= Search::MATE_BOUND_MAX);
+bool SearchInfo::is_mate() const {
+    return (score >= Search::MATE_BOUND) || (score <= -Search::MATE_BOUND);
+}
+
+
+TimeManager::TimeManager() {
+    start = get_time();
+    optimum = 0;
+    maximum = 0;
+    limited = false;
+    use_soft = false;
+    ponder = nullptr;
+    max_nodes = 0;
+}
+
+void TimeManager::init_clock(const Options& options, const Position& pos, const double& time, const double& inc,
+        const int& movestogo) {
+    /*
+    time and inc in seconds. movestogo is 0 in sudden death.
+    Plans for the remaining moves with the increment of each, keeping MoveOverhead per move in reserve.
+    */
+    const int moves = (movestogo > 0) ? std::min(movestogo, Search::TM_MOVES_LEFT) : Search::TM_MOVES_LEFT;
+    const double overhead = options.MoveOverhead / 1000.0;
+    const double safe = std::max(time - overhead, 0.0);
+    // The overhead of every remaining move is reserved, but never more than half of the clock.
+    const double time_left = std::max(time + inc*(moves-1) - overhead*moves, safe/2);
+
+    optimum = std::min(time_left / moves, safe * Search::TM_MAX_FRAC);
+    if (movestogo == 1) optimum = safe * Search::TM_MAX_FRAC;
+    maximum = std::min(optimum * Search::TM_MAX_RATIO, safe * Search::TM_MAX_FRAC);
+    limited = true;
+    use_soft = true;
+}
+
+void TimeManager::init_movetime(const Options& options, const double& movetime) {
+    optimum = maximum = std::max(movetime - options.MoveOverhead/1000.0, 0.0);
+    limited = true;
+    use_soft = false;
+}
+
+double TimeManager::elapsed() const {
+    return get_time() - start;
+}
+
+bool TimeManager::out_of_time() const {
+    // Time spent pondering counts, so a long ponder search ends right after ponderhit.
+    return limited && !pondering() && (elapsed() >= maximum);
+}
+
+bool TimeManager::out_of_nodes(const U64& nodes) const {
+    return (max_nodes > 0) && (nodes >= max_nodes);
+}
+
+bool TimeManager::pondering() const {
+    return (ponder != nullptr) && *ponder;
+}
+
+bool TimeManager::stop_iterating(const double& scale, const double& last_iter, const double& prev_iter) const {
+    /*
+    Called after a completed iteration.
+    scale: Multiplier of the optimum from search stability.
+    last_iter, prev_iter: Durations of the last two iterations, used to predict the next one.
+    */
+    if (!use_soft || pondering()) return false;
+    const double time = elapsed();
+    if (time >= optimum * scale) return true;
+
+    // An aborted iteration is thrown away, so don't start one that won't finish before the hard limit.
+    const double ebf = (prev_iter > 0.001) ? std::max(std::min(last_iter/prev_iter, 5.0), 1.5) : 2.0;
+    return time + last_iter*ebf >= maximum;
 }
 
 
 namespace Search {
-    float move_time(const Options& options, const Position& pos, const float& time, const float& inc) {
-        const int moves = std::max(55-pos.move_cnt, 5);
-        const float time_left = time + inc*moves;
-        const float move_time = time_left / moves;
-        return std::min(move_time, time/2);
+    int lmr_table[64][64];   // [depth][move number]
+
+    // Cuckoo tables of every reversible non-pawn move, keyed by Hash::move_key().
+    // Used to detect that a position can reach an earlier one in a single move.
+    constexpr int CUCKOO_SIZE = 8192;
+    U64 cuckoo_keys[CUCKOO_SIZE];
+    Move cuckoo_moves[CUCKOO_SIZE];
+
+    int cuckoo_h1(const U64& key) {
+        return key & (CUCKOO_SIZE-1);
+    }
+
+    int cuckoo_h2(const U64& key) {
+        return (key>>16) & (CUCKOO_SIZE-1);
+    }
+
+    bool empty_board_attack(const int& type, const int& from, const int& to) {
+        // Whether piece type (1=knight to 5=king) on from attacks to on an empty board.
+        const int dx = std::abs((from&7) - (to&7));
+        const int dy = std::abs((from>>3) - (to>>3));
+        switch (type) {
+            case 1: return (dx == 1 && dy == 2) || (dx == 2 && dy == 1);
+            case 2: return dx == dy;
+            case 3: return dx == 0 || dy == 0;
+            case 4: return dx == dy || dx == 0 || dy == 0;
+            case 5: return std::max(dx, dy) == 1;
+        }
+        return false;
+    }
+
+    U64 between(const int& a, const int& b) {
+        // Squares strictly between a and b if they share a line, otherwise empty.
+        const int dx = (b&7) - (a&7);
+        const int dy = (b>>3) - (a>>3);
+        if (!(dx == 0 || dy == 0 || std::abs(dx) == std::abs(dy))) return 0;
+        const int step = ((dy > 0) - (dy < 0))*8 + ((dx > 0) - (dx < 0));
+        U64 squares = 0;
+        for (int sq = a+step; sq != b; sq += step) squares |= 1ULL << sq;
+        return squares;
+    }
+
+    void init_cuckoo() {
+        for (int i = 0; i < CUCKOO_SIZE; i++) {
+            cuckoo_keys[i] = 0;
+            cuckoo_moves[i] = Move(0, 0);
+        }
+        for (int piece = 0; piece < 12; piece++) {
+            const int type = piece % 6;
+            if (type == 0) continue;    // Pawn moves are irreversible
+            for (int from = 0; from < 64; from++) {
+                for (int to = from+1; to < 64; to++) {
+                    if (!empty_board_attack(type, from, to)) continue;
+                    Move move(from, to);
+                    U64 key = Hash::move_key(piece, from, to);
+                    int i = cuckoo_h1(key);
+                    // Insert, displacing the occupant to its other slot until an empty one is found.
+                    while (true) {
+                        std::swap(cuckoo_keys[i], key);
+                        std::swap(cuckoo_moves[i], move);
+                        if (move == Move(0, 0)) break;
+                        i = (i == cuckoo_h1(key)) ? cuckoo_h2(key) : cuckoo_h1(key);
+                    }
+                }
+            }
+        }
+    }
+
+    void init() {
+        for (int d = 1; d < 64; d++) {
+            for (int m = 1; m < 64; m++) lmr_table[d][m] = 0.75 + std::log(d) * std::log(m) / 2.25;
+        }
+        init_cuckoo();
+    }
+
+    int moved_piece(const Position& pos, const Move& move) {
+        return Bitboard::piece_type(pos, move.from) + (pos.turn ? 0 : 6);
     }
 
+    void score_moves(ThreadData& data, const Position& pos, const Move* moves, const int& num_moves, int* scores,
+            const Move& hash_move, const bool& has_hash, const int& ply) {
+        /*
+        Assigns an ordering score to each move.
+        Hash move first, then winning and equal captures by SEE, then killers, then the countermove,
+        then quiets by butterfly and continuation history, then losing captures.
+        */
+        const StackEntry& frame = data.ss(ply);
+        const StackEntry& prev1 = data.ss(ply-1);
+        const StackEntry& prev2 = data.ss(ply-2);
+        const Move counter = (prev1.piece < 12) ? data.countermoves[prev1.piece][prev1.move.to] : Move(0, 0);
+
+        for (int i = 0; i < num_moves; i++) {
+            const Move& move = moves[i];
+            if (has_hash && (move == hash_move)) {
+                scores[i] = SCORE_HASH;
+            } else if (Bitboard::is_capture(pos, move) || move.is_promo) {
+                const int see = Eval::see(pos, move);
+                scores[i] = (see >= 0) ? SCORE_CAPTURE+see : SCORE_BAD_CAPTURE+see;
+            } else if (move == frame.killers[0]) {
+                scores[i] = SCORE_KILLER1;
+            } else if (move == frame.killers[1]) {
+                scores[i] = SCORE_KILLER2;
+            } else if (move == counter) {
+                scores[i] = SCORE_COUNTER;
+            } else {
+                const int piece_to = moved_piece(pos, move)*64 + move.to;
+                scores[i] = data.history[pos.turn][move.from][move.to];
+                if (prev1.cont_hist != nullptr) scores[i] += prev1.cont_hist[piece_to];
+                if (prev2.cont_hist != nullptr) scores[i] += prev2.cont_hist[piece_to];
+            }
+        }
+    }
+
+    void update_history(int& entry, const int& bonus) {
+        // Bonus is scaled down as the entry approaches HISTORY_MAX, so entries saturate instead of overflowing.
+        entry += bonus - entry * std::abs(bonus) / HISTORY_MAX;
+    }
+
+    void update_quiet_stats(ThreadData& data, const Position& pos, const int& best_ind, const int& depth, const int& ply) {
+        /*
+        Called on a beta cutoff by a quiet move.
+        Stores the move as a killer and countermove, and rewards it in the history tables,
+        penalizing quiets searched before it.
+        */
+        StackEntry& frame = data.ss(ply);
+        const Move& move = frame.moves[best_ind];
+        if (!(move == frame.killers[0])) {
+            frame.killers[1] = frame.killers[0];
+            frame.killers[0] = move;
+        }
+        const StackEntry& prev1 = data.ss(ply-1);
+        const StackEntry& prev2 = data.ss(ply-2);
+        if (prev1.piece < 12) data.countermoves[prev1.piece][prev1.move.to] = move;
+
+        const int bonus = std::min(depth*depth, 400);
+        for (int j = 0; j < frame.quiet_cnt; j++) {
+            const int i = frame.quiets[j];
+            const Move& curr = frame.moves[i];
+            const int curr_bonus = (i == best_ind) ? bonus : -bonus;
+            const int piece_to = moved_piece(pos, curr)*64 + curr.to;
+            update_history(data.history[pos.turn][curr.from][curr.to], curr_bonus);
+            if (prev1.cont_hist != nullptr) update_history(prev1.cont_hist[piece_to], curr_bonus);
+            if (prev2.cont_hist != nullptr) update_history(prev2.cont_hist[piece_to], curr_bonus);
+        }
+    }
 
-    SearchInfo dfs(const Options& options, const Position& pos, const int& depth, const int& real_depth,
-            float alpha, float beta, const bool& root, const double& endtime, bool& searching, U64& hash_filled) {
+    void gen_moves(ThreadData& data, StackEntry& frame, const Position& pos, const U64& o_attacks) {
+        // Legal moves into the frame, timed when statistics are on.
+        if (!data.stats_on) {
+            Bitboard::legal_moves(frame.moves, frame.num_moves, pos, o_attacks);
+            return;
+        }
+        const double start = get_time();
+        Bitboard::legal_moves(frame.moves, frame.num_moves, pos, o_attacks);
+        data.stats.movegen_time += get_time() - start;
+    }
+
+    int evaluate(const Options& options, ThreadData& data, const Position& pos, const int& num_moves, const int& ply,
+            const U64& o_attacks) {
+        // Static eval relative to the side to move, timed when statistics are on.
+        const double start = data.stats_on ? get_time() : 0;
+        const int score = Eval::eval(options, pos, num_moves, ply, o_attacks);
+        if (data.stats_on) data.stats.eval_time += get_time() - start;
+        return pos.turn ? score : -score;
+    }
+
+    void publish(const Options& options, ThreadData& data) {
+        // Stores the counters the reporter prints. Called at clock checks only.
+        Progress& progress = *data.progress;
+        progress.nodes.store(data.nodes, std::memory_order_relaxed);
+        progress.seldepth.store(data.seldepth, std::memory_order_relaxed);
+        progress.hashfull.store(options.hashfull(), std::memory_order_relaxed);
+    }
+
+    U64 hash_pos(ThreadData& data, const Position& pos) {
+        if (!data.stats_on) return Hash::hash(pos);
+        const double start = get_time();
+        const U64 hash = Hash::hash(pos);
+        data.stats.hash_time += get_time() - start;
+        return hash;
+    }
+
+    void set_stack(ThreadData& data, const Position& pos, const Move& move, const int& ply) {
+        // Records the move played at ply for the heuristics of later plies.
+        StackEntry& entry = data.ss(ply);
+        entry.move = move;
+        entry.piece = moved_piece(pos, move);
+        entry.cont_hist = data.cont_hist(entry.piece, move.to);
+        entry.null_move = false;
+        entry.reduction = 0;
+    }
+
+    void set_stack_null(ThreadData& data, const int& ply) {
+        StackEntry& entry = data.ss(ply);
+        entry.move = Move(0, 0);
+        entry.piece = 12;
+        entry.cont_hist = nullptr;
+        entry.null_move = true;
+        entry.reduction = 0;
+    }
+
+    void pick_move(Move* moves, int* scores, const int& num_moves, const int& start) {
+        // Swaps the highest scored remaining move into index start.
+        int best = start;
+        for (int i = start+1; i < num_moves; i++) {
+            if (scores[i] > scores[best]) best = i;
+        }
+        if (best != start) {
+            std::swap(moves[start], moves[best]);
+            std::swap(scores[start], scores[best]);
+        }
+    }
+
+
+    int score_to_tt(const int& score, const int& ply) {
+        // Mate scores are stored relative to the node, not the root.
+        if (score >= MATE_BOUND) return score + ply;
+        if (score <= -MATE_BOUND) return score - ply;
+        return score;
+    }
+
+    int score_from_tt(const int& score, const int& ply) {
+        if (score >= MATE_BOUND) return score - ply;
+        if (score <= -MATE_BOUND) return score + ply;
+        return score;
+    }
+
+
+    void store_tt(Transposition& entry, const unsigned int& key, const Move& move, const int& depth, const int& score,
+            const char& bound) {
+        // Replaces entries of other positions, or of the same position searched no deeper.
+        if ((entry.key == key) && (depth < entry.depth)) return;
+
+        entry.key = key;
+        entry.from = move.from + (move.promo<<6);
+        entry.to = move.to + (move.is_promo<<6);
+        entry.depth = depth;
+        entry.score = score;
+        entry.bound = bound;
+    }
+
+
+    int quiesce(const Options& options, ThreadData& data, const Position& pos, const int& ply, int alpha, const int& beta) {
+        /*
+        Searches captures (and all evasions when in check) until the position is quiet.
+        Captures that lose material according to SEE are pruned.
+        */
+        data.nodes++;
+        if (data.stats_on) data.stats.qnodes++;
+        data.pv_len[ply] = 0;
+        if (ply > data.seldepth) data.seldepth = ply;
+
+        StackEntry& frame = data.ss(ply);
+        Move* moves = frame.moves;
+        int* scores = frame.scores;
         const U64 o_attacks = Bitboard::attacked(pos, !pos.turn);
-        vector<Move> moves = Bitboard::legal_moves(pos, o_attacks);
+        gen_moves(data, frame, pos, o_attacks);
+        const int num_moves = frame.num_moves;
+        const bool in_check = (o_attacks & (pos.turn ? pos.wk : pos.bk)) != 0;
+
+        if (num_moves == 0) return in_check ? -MATE+ply : 0;
+        if (pos.draw50 >= 100) return 0;
+        const int static_eval = evaluate(options, data, pos, num_moves, ply, o_attacks);
+        frame.static_eval = in_check ? -INF : static_eval;
+        if (ply >= MAX_PLY) return static_eval;
 
-        if (depth == 0 || moves.empty()) {
-            const float score = Eval::eval(options, pos, moves, real_depth, o_attacks);
-            return SearchInfo(depth, depth, score, 1, 0, 0, 0, {}, alpha, beta, true);
+        int best_score = -MATE + ply;
+        if (!in_check) {
+            // Stand pat: side to move can decline every capture.
+            best_score = static_eval;
+            if (best_score >= beta) return best_score;
+            if (best_score > alpha) alpha = best_score;
         }
 
-        // Parse and store best move
-        const U64 idx = Hash::hash(pos) % options.hash_size;
-        Transposition& entry = options.hash_table[idx];
-        const Move best(entry.from&63, entry.to&63, entry.to&64, (entry.from&192)>>6);
-        if (entry.depth > 0) moves.insert(moves.begin(), best);
+        score_moves(data, pos, moves, num_moves, scores, Move(), false, ply);
+        for (int i = 0; i < num_moves; i++) {
+            pick_move(moves, scores, num_moves, i);
+            if (!in_check && (scores[i] < SCORE_CAPTURE)) break;  // Quiets and losing captures
 
-        U64 nodes = 1;
-        vector<Move> pv;
-        int best_ind = 0;
-        float best_eval = pos.turn ? MIN : MAX;
-        bool full = true;
-        int movecnt = 0;  // Need to use this bc will skip a repeated best move so i != movecnt
-        for (unsigned int i = 0; i < moves.size(); i++) {
-            if (depth >= 3) {
-                if ((get_time() >= endtime) || !searching) {
-                    full = false;
-                    break;
+            set_stack(data, pos, moves[i], ply);
+            StackEntry& child = data.ss(ply+1);
+            child.pos = Bitboard::push(pos, moves[i]);
+            const int score = -quiesce(options, data, child.pos, ply+1, -beta, -alpha);
+            if (score > best_score) {
+                best_score = score;
+                if (score > alpha) {
+                    alpha = score;
+                    if (alpha >= beta) break;
                 }
             }
-            if ((i != 0) && (entry.depth > 0)) {  // Don't search best move twice
-                const Move& curr = moves[i];
-                if ((best.from == curr.from) && (best.to == curr.to) && (best.is_promo == curr.is_promo) &&
-                        (best.promo == curr.promo)) continue;
+        }
+
+        return best_score;
+    }
+
+    U64 key_at(ThreadData& data, const int& ply) {
+        // Key of the position at ply, negative plies index the game history. 0 if unknown.
+        if (ply >= 0) return data.ss(ply).key;
+        const int i = (int)data.game_keys.size() + ply;
+        return (i >= 0) ? data.game_keys[i] : 0;
+    }
+
+    bool is_repetition(ThreadData& data, const Position& pos, const int& ply) {
+        // Only positions since the last pawn move, capture or null move can repeat.
+        const U64 key = data.ss(ply).key;
+        const int end = std::min((int)pos.draw50, data.ss(ply).plies_from_null);
+        for (int i = 4; i <= end; i += 2) {
+            const U64 other = key_at(data, ply-i);
+            if (other == 0) break;
+            if (other == key) return true;
+        }
+        return false;
+    }
+
+    bool upcoming_repetition(ThreadData& data, const Position& pos, const int& ply) {
+        /*
+        Whether the side to move can reach a position of the current search path in one reversible move,
+        i.e. can force a draw by repetition. The key difference is looked up in the cuckoo tables.
+        */
+        const U64 key = data.ss(ply).key;
+        const int end = std::min((int)pos.draw50, data.ss(ply).plies_from_null);
+        if (end < 3) return false;
+        const U64 occupied = Bitboard::get_all(pos);
+
+        // Cycles back to the root or the game history are left to the root search.
+        for (int i = 3; i <= end && i < ply; i += 2) {
+            const U64 diff = key ^ key_at(data, ply-i);
+            int j = cuckoo_h1(diff);
+            if (cuckoo_keys[j] != diff) {
+                j = cuckoo_h2(diff);
+                if (cuckoo_keys[j] != diff) continue;
+            }
+            const Move& move = cuckoo_moves[j];
+            if ((between(move.from, move.to) & occupied) == 0) return true;
+        }
+        return false;
+    }
+
+    void update_pv(ThreadData& data, const Move& move, const int& ply) {
+        // Triangular PV table: the PV at ply is the move followed by the child's PV.
+        data.pv[ply][0] = move;
+        for (int i = 0; i < data.pv_len[ply+1]; i++) data.pv[ply][i+1] = data.pv[ply+1][i];
+        data.pv_len[ply] = data.pv_len[ply+1] + 1;
+    }
+
+    int dfs(const Options& options, ThreadData& data, const Position& pos, int depth, const int& ply,
+            int alpha, const int& beta, const bool& root, const TimeManager& tm, const std::atomic<bool>& searching) {
+        /*
+        Negamax alpha-beta search.
+        pos is data.ss(ply).pos. The frame at ply is shared with the reduced searches of this node
+        (razoring, null move verification, IID), which regenerate its move list, so moves are scored after them.
+        return: Score relative to the side to move. Meaningless if data.stopped is set.
+        */
+        if (depth <= 0) return quiesce(options, data, pos, ply, alpha, beta);
+        data.nodes++;
+        data.pv_len[ply] = 0;
+
+        // Polling by node count keeps clock reads out of the hot path. The first iteration always completes.
+        // With a node limit the poll lands exactly on it, and no clock is involved, so the search is reproducible.
+        if (data.nodes >= data.next_check) {
+            data.next_check = data.nodes + TIME_CHECK_NODES;
+            if (tm.max_nodes > 0) data.next_check = std::min(data.next_check, tm.max_nodes);
+            if (data.progress != nullptr) publish(options, data);
+            if ((data.root_depth > 1) && (!searching || tm.out_of_nodes(data.nodes) || tm.out_of_time())) {
+                data.stopped = true;
             }
-            movecnt++;
+        }
+        if (data.stopped) return 0;
+
+        StackEntry& frame = data.ss(ply);
+        StackEntry& child = data.ss(ply+1);
+        const U64 hash = hash_pos(data, pos);
+        frame.key = hash;
+        frame.plies_from_null = root ? pos.draw50 : (data.ss(ply-1).null_move ? 0 : data.ss(ply-1).plies_from_null+1);
 
-            const Position new_pos = Bitboard::push(pos, moves[i]);
-            const SearchInfo result = dfs(options, new_pos, depth-1, real_depth+1, alpha, beta, false, endtime, searching, hash_filled);
-            nodes += result.nodes;
+        // Taken from the window as passed in, before the repetition bound below can narrow it.
+        const bool pv_node = (beta - alpha) > 1;
+        const int alpha_orig = alpha;
 
-            if (root && (depth >= 5)) {
-                cout << "info depth " << depth << " currmove " << Bitboard::move_str(moves[i]) << " currmovenumber " << movecnt << endl;
+        if (!root) {
+            if (is_repetition(data, pos, ply)) return 0;
+            // If the side to move can repeat, the node is worth at least a draw.
+            if ((alpha < 0) && upcoming_repetition(data, pos, ply)) {
+                alpha = 0;
+                if (alpha >= beta) return alpha;
             }
+        }
+
+        Move* moves = frame.moves;
+        int* scores = frame.scores;
+        const U64 o_attacks = Bitboard::attacked(pos, !pos.turn);
+        if (root) {
+            // The root searches its persistent move list in order.
+            frame.num_moves = data.root_moves.size();
+            for (int i = 0; i < frame.num_moves; i++) moves[i] = data.root_moves[i].move;
+        } else {
+            gen_moves(data, frame, pos, o_attacks);
+        }
+        const int num_moves = frame.num_moves;
+        const bool in_check = (o_attacks & (pos.turn ? pos.wk : pos.bk)) != 0;
+
+        if (num_moves == 0) return in_check ? -MATE+ply : 0;
+        if (!root && (pos.draw50 >= 100)) return 0;
 
-            if (pos.turn) {
-                if (result.score > best_eval) {
-                    best_ind = i;
-                    best_eval = result.score;
-                    pv = result.pv;
+        // Probe transposition table. The root orders its moves itself.
+        const unsigned int key = hash >> 32;
+        Transposition& entry = options.hash_table[hash % options.hash_size];
+        bool tt_hit = !root && (entry.depth > 0) && (entry.key == key);
+        if (data.stats_on && !root) {
+            data.stats.tt_probes++;
+            if (tt_hit) data.stats.tt_hits++;
+        }
+        if (tt_hit && !pv_node && (entry.depth >= depth)) {
+            const int tt_score = score_from_tt(entry.score, ply);
+            if ((entry.bound == BOUND_EXACT) || ((entry.bound == BOUND_LOWER) && (tt_score >= beta)) ||
+                    ((entry.bound == BOUND_UPPER) && (tt_score <= alpha))) {
+                if (data.stats_on) data.stats.tt_cutoffs++;
+                return tt_score;
+            }
+        }
+
+        // Internal iterative reduction: without a hash move ordering is poor, so a non-PV node
+        // is searched one ply shallower instead.
+        if (options.IIR && !pv_node && !tt_hit && (depth >= IIR_DEPTH)) depth--;
+
+        const int static_eval = in_check ? -INF : evaluate(options, data, pos, num_moves, ply, o_attacks);
+        frame.static_eval = static_eval;
+
+        // Reverse futility pruning: static eval is so far above beta that no move will bring it back.
+        if (!pv_node && !in_check && (depth <= RFP_DEPTH) && (static_eval < MATE_BOUND) &&
+                (static_eval - options.RFPMargin*depth >= beta)) {
+            return static_eval;
+        }
+
+        // Razoring: static eval is far below alpha, so only captures can save the node.
+        if (!pv_node && !in_check && (depth <= RAZOR_DEPTH) && (static_eval + options.RazorMargin*depth < alpha)) {
+            const int score = quiesce(options, data, pos, ply, alpha-1, alpha);
+            if (score < alpha) return score;
+        }
+
+        // Null move pruning: if passing still fails high with a reduced search, a real move will too.
+        // Unsafe in check, in pawn endings (zugzwang) and right after the opponent passed.
+        if (!pv_node && !in_check && (depth >= NMP_DEPTH) && (static_eval >= beta) && (ply >= data.nmp_min_ply) &&
+                !data.ss(ply-1).null_move && (Eval::non_pawn_mat(pos, pos.turn) > 0) && (beta > -MATE_BOUND)) {
+            const int r = 3 + depth/4;
+            if (data.stats_on) data.stats.null_tries++;
+            set_stack_null(data, ply);
+            child.pos = Bitboard::push_null(pos);
+            int null_score = -dfs(options, data, child.pos, depth-1-r, ply+1, -beta, -beta+1,
+                false, tm, searching);
+            if (data.stopped) return 0;
+
+            if (null_score >= beta) {
+                if (null_score >= MATE_BOUND) null_score = beta;   // Don't trust mates found by passing
+                if (data.stats_on) data.stats.null_cutoffs++;
+                if (depth < NMP_VERIFY_DEPTH) return null_score;
+
+                // Verify with null moves disabled for the first part of the subtree.
+                data.nmp_min_ply = ply + 3*(depth-r)/4;
+                const int verify = dfs(options, data, pos, depth-r, ply, beta-1, beta, false, tm, searching);
+                data.nmp_min_ply = 0;
+                if (data.stopped) return 0;
+                if (verify >= beta) return null_score;
+            }
+        }
+
+        // Internal iterative deepening: a PV node without a hash move gets a shallower search first,
+        // which leaves a best move in the TT.
+        if (options.IID && pv_node && !root && !tt_hit && (depth >= IID_DEPTH)) {
+            dfs(options, data, pos, depth-2, ply, alpha, beta, root, tm, searching);
+            if (data.stopped) return 0;
+            tt_hit = (entry.depth > 0) && (entry.key == key);
+        }
+
+        const Move best(entry.from&63, entry.to&63, entry.to&64, (entry.from&192)>>6);
+        if (root) {
+            for (int i = 0; i < num_moves; i++) scores[i] = -i;   // Keeps the order, neutral for LMR
+        } else {
+            score_moves(data, pos, moves, num_moves, scores, best, tt_hit, ply);
+        }
+
+        // ProbCut: a good capture that beats beta by a margin at reduced depth very likely refutes the node.
+        // Skipped when the TT already shows a deep enough search that stayed below the raised beta.
+        const int probcut_beta = beta + PROBCUT_MARGIN;
+        if (!pv_node && !in_check && (depth >= PROBCUT_DEPTH) && (beta > -MATE_BOUND) && (beta < MATE_BOUND) &&
+                !(tt_hit && (entry.depth >= depth-3) && (score_from_tt(entry.score, ply) < probcut_beta))) {
+            for (int i = 0; i < num_moves; i++) {
+                const Move& move = moves[i];
+                if (!Bitboard::is_capture(pos, move) && !move.is_promo) continue;
+                if (Eval::see(pos, move) < probcut_beta - static_eval) continue;
+
+                set_stack(data, pos, move, ply);
+                child.pos = Bitboard::push(pos, move);
+
+                // Quiescence first to discard captures that don't even hold statically.
+                int score = -quiesce(options, data, child.pos, ply+1, -probcut_beta, -probcut_beta+1);
+                if (score >= probcut_beta) {
+                    score = -dfs(options, data, child.pos, depth-4, ply+1, -probcut_beta, -probcut_beta+1,
+                        false, tm, searching);
+                    if (data.stopped) return 0;
                 }
-                if (result.score > alpha) alpha = result.score;
-                if (beta < alpha) break;
-            } else {
-                if (result.score < best_eval) {
-                    best_ind = i;
-                    best_eval = result.score;
-                    pv = result.pv;
+                if (score >= probcut_beta) {
+                    store_tt(entry, key, move, depth-3, score_to_tt(score, ply), BOUND_LOWER);
+                    return score;
                 }
-                if (result.score < beta) beta = result.score;
-                if (beta < alpha) break;
             }
         }
-        pv.insert(pv.begin(), moves[best_ind]);
 
-        if (depth > entry.depth) {
-            if (entry.depth == 0) hash_filled++;
+        int best_ind = 0;
+        int best_score = -INF;
+        int movecnt = 0;
+        frame.quiet_cnt = 0;
+        data.pv_len[ply] = 0;
+        for (int i = 0; i < num_moves; i++) {
+            pick_move(moves, scores, num_moves, i);
+            if (root && (std::find(data.root_excluded.begin(), data.root_excluded.end(), moves[i]) != data.root_excluded.end())) {
+                continue;
+            }
+            const bool quiet = !moves[i].is_promo && !Bitboard::is_capture(pos, moves[i]);
+
+            // Late move pruning: at shallow depth, late quiets are unlikely to matter.
+            if (!pv_node && !in_check && quiet && (depth <= LMP_DEPTH) && (movecnt >= 3+depth*depth) &&
+                    (best_score > -MATE_BOUND)) {
+                continue;
+            }
+            // Futility pruning: quiets at frontier nodes can't raise a static eval this far below alpha.
+            if (!pv_node && !in_check && quiet && (depth <= FUTILITY_DEPTH) && (movecnt > 0) &&
+                    (best_score > -MATE_BOUND) && (static_eval + options.FutilityMargin*depth <= alpha)) {
+                continue;
+            }
+            // Prune quiet moves that hang material near the leaves.
+            if (!root && !in_check && quiet && (depth <= SEE_PRUNE_DEPTH) && (movecnt > 0) && (scores[i] < SCORE_HASH) &&
+                    (Eval::see(pos, moves[i]) < -SEE_QUIET_MARGIN*depth)) {
+                continue;
+            }
+            movecnt++;
+            if (quiet) frame.quiets[frame.quiet_cnt++] = i;
+            if (root && (data.progress != nullptr)) {
+                const Move& move = moves[i];
+                data.progress->currmove.store(move.from | (move.to<<6) | (move.is_promo<<12) | (move.promo<<13),
+                    std::memory_order_relaxed);
+                data.progress->currmove_num.store(movecnt, std::memory_order_relaxed);
+            }
+
+            set_stack(data, pos, moves[i], ply);
+            child.pos = Bitboard::push(pos, moves[i]);
+            const Position& new_pos = child.pos;
+            const U64 nodes_before = data.nodes;
+            // Principal variation search: only the first move gets the full window. The rest are
+            // searched with a null window and re-searched if they turn out better than alpha.
+            int score;
+            if (movecnt == 1) {
+                score = -dfs(options, data, new_pos, depth-1, ply+1, -beta, -alpha, false, tm, searching);
+            } else {
+                // Late move reductions: quiets late in the ordering are searched shallower first.
+                int r = 0;
+                if (quiet && !in_check && (depth >= LMR_DEPTH) && (movecnt > (pv_node ? 2 : 1))) {
+                    r = lmr_table[std::min(depth, 63)][std::min(movecnt, 63)];
+                    if (pv_node) r--;
+                    if (scores[i] >= SCORE_COUNTER) r--;  // Killers and countermove
+                    else r -= std::max(std::min(scores[i] / 8192, 2), -2);
+                    r = std::max(std::min(r, depth-2), 0);
+                }
+                frame.reduction = r;
+
+                score = -dfs(options, data, new_pos, depth-1-r, ply+1, -alpha-1, -alpha, false, tm, searching);
+                if (r > 0) {
+                    data.stats.reduced++;
+                    data.stats.reduction_sum += r;
+                    if (!data.stopped && (score > alpha)) {
+                        data.stats.researches++;
+                        score = -dfs(options, data, new_pos, depth-1, ply+1, -alpha-1, -alpha, false, tm, searching);
+                    }
+                }
+                if (pv_node && !data.stopped && (score > alpha) && (score < beta)) {
+                    score = -dfs(options, data, new_pos, depth-1, ply+1, -beta, -alpha, false, tm, searching);
+                }
+            }
+            if (root) data.root_moves[i].nodes += data.nodes - nodes_before;
+            if (data.stopped) return 0;     // Child was interrupted, so its score is unreliable.
+
+            if (score > best_score) {
+                best_ind = i;
+                best_score = score;
+                if (score > alpha) {
+                    alpha = score;
+                    update_pv(data, moves[i], ply);
+                    if (root) data.root_moves[i].score = score;
+                }
+            }
+            if (alpha >= beta) {
+                data.stats.cutoffs++;
+                if (movecnt == 1) data.stats.first_cutoffs++;
+                if (quiet) update_quiet_stats(data, pos, i, depth, ply);
+                break;
+            }
+        }
 
-            const Move& best_move = moves[best_ind];
-            entry.from = best_move.from + (best_move.promo<<6);
-            entry.to = best_move.to + (best_move.is_promo<<6);
-            entry.depth = depth;
+        char bound = BOUND_UPPER;
+        if (best_score >= beta) bound = BOUND_LOWER;
+        else if (best_score > alpha_orig) bound = BOUND_EXACT;
+        // With excluded root moves the result isn't the root's true score.
+        if (!(root && !data.root_excluded.empty())) {
+            store_tt(entry, key, moves[best_ind], depth, score_to_tt(best_score, ply), bound);
         }
 
-        return SearchInfo(depth, depth, best_eval, nodes, 0, 0, 0, pv, alpha, beta, full);
+        return best_score;
     }
 
-    SearchInfo search(const Options& options, const Position& pos, const int& depth, const double& movetime,
-            const bool& infinite, bool& searching, const bool& stop_early) {
+    SearchInfo search(const Options& options, const Position& pos, const vector<U64>& history, const int& depth,
+            TimeManager& tm, const bool& infinite, const std::atomic<bool>& searching, ThreadData& data, Progress* progress) {
+        /*
+        history: Keys of the game positions before pos, oldest first. Used for repetition detection.
+        data: Kept by the caller between searches, so the move ordering tables carry over.
+        progress: Receives counters for a reporter thread, see report().
+        */
         const int eg = Endgame::eg_type(pos);
         const U64 o_attacks = Bitboard::attacked(pos, !pos.turn);
         const vector<Move> moves = Bitboard::legal_moves(pos, o_attacks);
@@ -177,38 +991,173 @@ namespace Search {
         }
         if (false && (eg != 0)) {
             const Move best_move = Endgame::bestmove(pos, moves, eg);
-            return SearchInfo(1, 1, pos.turn ? MAX : MIN, moves.size(), 0, 0, 0, {best_move}, 0, 0, true);
+            return SearchInfo(1, 1, MATE, moves.size(), 0, 0, 0, {best_move}, 0, 0, true);
         }
 
         SearchInfo result;
-        U64 hash_filled = 0;
-        U64 nodes = 0;
-        const double start = get_time();
-        const double end = start + movetime;
+        data.new_search();
+        data.game_keys = history;
+        data.stats_on = DEBUG_MODE || options.debug;
+        data.stats.enabled = data.stats_on;
+        data.progress = progress;
+
+        // Search stability, used to scale the soft time limit
+        double best_changes = 0;
+        int stable_iters = 0;
+        double last_iter = 0, prev_iter = 0;
+
+        // MultiPV: each iteration searches the best line, then the best excluding the first moves found so far.
+        const int multipv = std::max(std::min(options.MultiPV, (int)moves.size()), 1);
+        vector<SearchInfo> lines;
+        for (const auto& move: moves) data.root_moves.push_back(RootMove(move));
+
+        for (int d = 1; d <= std::min(depth, MAX_PLY-1); d++) {
+            if ((d > 1) && (!searching || tm.out_of_nodes(data.nodes) || tm.out_of_time())) break;
+            const double iter_start = tm.elapsed();
+            data.root_depth = d;
+            if (progress != nullptr) progress->depth.store(d, std::memory_order_relaxed);
+            data.age();
+            data.root_excluded.clear();
+            for (auto& rm: data.root_moves) {
+                rm.score = -INF;
+                rm.nodes = 0;
+            }
+
+            vector<SearchInfo> curr_lines;
+            for (int k = 0; k < multipv; k++) {
+                // Aspiration window around the previous score of this line, widened on each fail.
+                const bool has_prev = (k < (int)lines.size());
+                int delta = ASP_WINDOW;
+                int alpha = -INF, beta = INF;
+                if ((d >= ASP_DEPTH) && has_prev && !lines[k].is_mate()) {
+                    alpha = std::max(lines[k].score-delta, -INF);
+                    beta = std::min(lines[k].score+delta, INF);
+                }
+
+                int score;
+                data.seldepth = 0;
+                data.ss(0).pos = pos;
+                while (true) {
+                    score = dfs(options, data, data.ss(0).pos, d, 0, alpha, beta, true, tm, searching);
+                    if (data.stopped) break;
+
+                    if (score <= alpha) {
+                        beta = (alpha+beta) / 2;
+                        alpha = std::max(score-delta, -INF);
+                    } else if (score >= beta) {
+                        beta = std::min(score+delta, INF);
+                    } else {
+                        break;
+                    }
+                    delta += delta / 2;
+                }
+                if (data.stopped) break;
+
+                const double elapse = tm.elapsed();
+                const vector<Move> pv(data.pv[0], data.pv[0]+data.pv_len[0]);
+                SearchInfo line(d, data.seldepth, score, data.nodes, data.nodes/(elapse+0.001),
+                    options.hashfull(), elapse, pv, alpha, beta, true);
+                line.stats = data.stats;
+                curr_lines.push_back(line);
+                if (pv.empty()) break;      // No legal moves
+                data.root_excluded.push_back(pv[0]);
+            }
+            if (data.stopped) {
+                // The best line of an interrupted iteration is still a complete search.
+                // It is printed, so the last PV the GUI shows agrees with bestmove.
+                if (!curr_lines.empty()) {
+                    result = curr_lines[0];
+                    result.multipv = 1;
+                    Output::line(result.as_string());
+                }
+                break;
+            }
+            data.stats.iter_nodes.push_back(data.nodes);
 
-        for (char d = 1; d <= depth; d++) {
-            if (!searching || get_time() >= end) break;
+            // Later lines are searched with fewer moves, so their scores aren't always lower.
+            std::stable_sort(curr_lines.begin(), curr_lines.end(),
+                [](const SearchInfo& a, const SearchInfo& b) { return a.score > b.score; });
+            for (unsigned int k = 0; k < curr_lines.size(); k++) {
+                curr_lines[k].multipv = k + 1;
+                Output::line(curr_lines[k].as_string());
+            }
+            const SearchInfo& best = curr_lines[0];
+            const double elapse = tm.elapsed();
 
-            SearchInfo curr_result = dfs(options, pos, d, 0, MIN, MAX, true, end, searching, hash_filled);
-            const double elapse = get_time() - start;
-            nodes += curr_result.nodes;
+            // Next iteration: the lines in order, then moves that raised alpha, then by subtree size.
+            for (auto& rm: data.root_moves) {
+                for (const auto& line: curr_lines) {
+                    if (!line.pv.empty() && (line.pv[0] == rm.move)) rm.score = line.score;
+                }
+            }
+            std::stable_sort(data.root_moves.begin(), data.root_moves.end(), [](const RootMove& a, const RootMove& b) {
+                return (a.score != b.score) ? (a.score > b.score) : (a.nodes > b.nodes);
+            });
 
-            curr_result.time = elapse;
-            curr_result.nodes = nodes;
-            curr_result.nps = curr_result.nodes / (elapse+0.001);
-            curr_result.hashfull = 1000 * hash_filled / options.hash_size;
-            if (!pos.turn) curr_result.score *= -1;
-            if (curr_result.full) {
-                cout << curr_result.as_string() << endl;
-                result = curr_result;
+            // A changing best move or a dropping score asks for more time, a stable best move for less.
+            best_changes /= 2;
+            if ((d > 1) && !result.pv.empty() && !best.pv.empty() && !(best.pv[0] == result.pv[0])) {
+                best_changes++;
+                stable_iters = 0;
+            } else {
+                stable_iters++;
             }
-            if (curr_result.is_mate() && (curr_result.score > 0) && !infinite) break;
+            const int score_drop = (d > 1) ? result.score - best.score : 0;
+            const double instability = 1 + best_changes;
+            const double falling = std::max(std::min(1 + score_drop/200.0, 1.5), 1.0);
+            const double stability = std::max(1.25 - 0.1*stable_iters, 0.6);
 
-            // if (stop_early && ((elapse/movetime) >= 0.6)) {    // Won't finish next depth so no point
-            //     break;
-            // }
+            prev_iter = last_iter;
+            last_iter = elapse - iter_start;
+            result = best;
+            lines = curr_lines;
+            if (best.is_mate() && (best.score > 0) && !infinite) break;
+            if (!infinite && tm.stop_iterating(instability*falling*stability, last_iter, prev_iter)) break;
         }
 
+        data.stats.nodes = data.nodes;
+        result.stats = data.stats;
         return result;
     }
+
+    SearchInfo search(const Options& options, const Position& pos, const vector<U64>& history, const int& depth,
+            TimeManager& tm, const bool& infinite, const std::atomic<bool>& searching) {
+        // Search with fresh tables, independent of earlier searches. Used by bench.
+        ThreadData data;
+        return search(options, pos, history, depth, tm, infinite, searching, data);
+    }
+
+    void report(Progress& progress) {
+        /*
+        Reporter thread: while a search is active, prints its progress every progress.interval milliseconds.
+        Runs until progress.close(), so the search thread never waits on output.
+        Lines are printed under the mutex, so none follows finish().
+        */
+        std::unique_lock<std::mutex> lock(progress.mutex);
+        const auto search_over = [&]() { return !progress.active || progress.quit; };
+        while (true) {
+            progress.cv.wait(lock, [&]() { return progress.active || progress.quit; });
+            if (progress.quit) return;
+
+            while (!progress.cv.wait_for(lock, std::chrono::milliseconds(progress.interval), search_over)) {
+                const double elapse = progress.tm->elapsed();
+
+                const int depth = progress.depth.load(std::memory_order_relaxed);
+                const U64 nodes = progress.nodes.load(std::memory_order_relaxed);
+                string str = "info depth " + std::to_string(depth);
+                str += " seldepth " + std::to_string(progress.seldepth.load(std::memory_order_relaxed));
+                str += " nodes " + std::to_string(nodes) + " nps " + std::to_string((U64)(nodes/(elapse+0.001)));
+                str += " hashfull " + std::to_string(progress.hashfull.load(std::memory_order_relaxed));
+                str += " time " + std::to_string((int)(1000*elapse));
+
+                const int code = progress.currmove.load(std::memory_order_relaxed);
+                if (code >= 0) {
+                    const Move move(code&63, (code>>6)&63, (code>>12)&1, code>>13);
+                    str += "\ninfo depth " + std::to_string(depth) + " currmove " + Bitboard::move_str(move);
+                    str += " currmovenumber " + std::to_string(progress.currmove_num.load(std::memory_order_relaxed));
+                }
+                Output::line(str);
+            }
+        }
+    }
 }
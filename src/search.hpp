@@ -22,6 +22,9 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include "bitboard.hpp"
 #include "options.hpp"
 
@@ -31,36 +34,223 @@ using std::endl;
 using std::vector;
 using std::string;
 
+namespace Search {
+    constexpr int MAX_PLY = 100;
+
+    // Scores are centipawns. A mate in n plies scores MATE-n.
+    constexpr int MATE = 30000;
+    constexpr int INF = 30001;
+    constexpr int MATE_BOUND = MATE - MAX_PLY;
+}
+
+struct StackEntry {
+    // One frame per ply, preallocated per thread so the recursive search doesn't allocate.
+    StackEntry();
+
+    Position pos;                          // Position at this ply, written by the parent
+    Move moves[Bitboard::MAX_MOVES];       // Legal moves, reordered in place while searching
+    int scores[Bitboard::MAX_MOVES];       // Ordering score of each move
+    int num_moves;
+    int quiets[Bitboard::MAX_MOVES];       // Indices of quiets searched so far, penalized on a cutoff
+    int quiet_cnt;
+    int static_eval;                       // Relative to side to move, -INF when in check
+    U64 key;                               // Hash of pos, set by dfs for repetition detection
+    int plies_from_null;                   // Plies since the last null move, repetitions can't span one
+    Move killers[2];
+
+    Move move;       // Move played from this ply
+    int piece;       // Piece that made the move, 0-5 white, 6-11 black, 12 none
+    int* cont_hist;  // Continuation history row for (piece, move.to), nullptr if none
+    bool null_move;  // The side at this ply passed
+    int reduction;   // LMR reduction applied to move
+};
+
+struct RootMove {
+    RootMove(const Move&);
+
+    Move move;
+    int score;      // Score when it last raised alpha this iteration, -INF if it never did
+    U64 nodes;      // Size of its subtree this iteration
+};
+
+struct SearchStats {
+    /*
+    The cutoff and LMR counters are always kept, bench reports them.
+    The rest are only kept when enabled (debug on or DEBUG_MODE), the search skips them otherwise.
+    */
+    SearchStats();
+    void add(const SearchStats&);
+    string as_string() const;
+
+    U64 cutoffs;
+    U64 first_cutoffs;
+    U64 reduced;          // Moves searched with a late move reduction
+    U64 reduction_sum;    // Total plies reduced
+    U64 researches;       // Reduced moves re-searched at full depth
+
+    bool enabled;
+    U64 nodes;            // Set when the search ends
+    U64 tt_probes;
+    U64 tt_hits;
+    U64 tt_cutoffs;       // Nodes returned straight from a TT score
+    U64 qnodes;
+    U64 null_tries;
+    U64 null_cutoffs;
+    vector<U64> iter_nodes;   // Total nodes at the end of each iteration
+    double movegen_time;  // Seconds
+    double eval_time;
+    double hash_time;
+};
+
+struct TimeManager;
+
+struct Progress {
+    /*
+    Counters the search publishes at each clock check for the reporter thread, which does the printing.
+    Relaxed atomics: the reporter only needs recent values, not a consistent snapshot.
+    The reporter lives as long as the worker, begin() and finish() bracket each search.
+    */
+    Progress();
+    void begin(const TimeManager*, const int&);
+    void finish();
+    void close();
+
+    std::atomic<U64> nodes;
+    std::atomic<int> depth;
+    std::atomic<int> seldepth;
+    std::atomic<int> hashfull;
+    std::atomic<int> currmove;      // Root move being searched, from | to<<6 | is_promo<<12 | promo<<13. -1 if none
+    std::atomic<int> currmove_num;
+    std::mutex mutex;
+    std::condition_variable cv;     // Wakes the reporter on begin(), finish() and close()
+    const TimeManager* tm;          // Clock of the reported search. The rest is guarded by mutex
+    int interval;                   // Milliseconds between lines
+    bool active;                    // Between begin() and finish()
+    bool quit;                      // Set by close(), the reporter exits
+};
+
+struct ThreadData {
+    ThreadData();
+    void clear();
+    void new_search();
+    void age();
+    StackEntry& ss(const int&);
+    int* cont_hist(const int&, const int&);
+
+    vector<StackEntry> stack;   // MAX_PLY+3 frames, two sentinel entries below the root
+    Move countermoves[12][64];  // [previous piece][previous to]
+    int history[2][64][64];     // Butterfly table: [side][from][to]
+    vector<int> cont_history;   // [previous piece][previous to][piece][to]
+    vector<U64> game_keys;      // Keys of the game positions before the root, oldest first
+    vector<Move> root_excluded; // Root moves skipped, the first moves of earlier MultiPV lines
+    vector<RootMove> root_moves;  // Root moves in search order, re-sorted after each iteration
+
+    Move pv[Search::MAX_PLY+1][Search::MAX_PLY+1];  // Triangular PV table, pv[ply] is the PV from ply
+    int pv_len[Search::MAX_PLY+1];
+
+    int nmp_min_ply;   // Null move pruning is disabled below this ply during verification
+    int root_depth;
+    U64 nodes;
+    U64 next_check;    // Node count at which the clock is checked next
+    int seldepth;
+    bool stopped;      // Set when the search runs out of time or is stopped; scores after that are meaningless
+
+    SearchStats stats;
+    bool stats_on;     // Keep the optional counters in stats
+    Progress* progress;  // nullptr if nothing is reported during the search
+};
+
 struct SearchInfo {
     SearchInfo();
-    SearchInfo(const int&, const int&, const float&, const U64&, const int&, const int&, const double&, const vector<Move>&,
-        const float&, const float&, const bool&);
-    string as_string();
-    bool is_mate();
+    SearchInfo(const int&, const int&, const int&, const U64&, const int&, const int&, const double&, const vector<Move>&,
+        const int&, const int&, const bool&);
+    string as_string() const;
+    bool is_mate() const;
 
+    int multipv;    // Rank of this line, 1 is the best
     int depth;
     int seldepth;
-    float score;
+    int score;      // Centipawns, relative to side to move
     U64 nodes;
     int nps;
     int hashfull;
     double time;
     vector<Move> pv;
 
-    float alpha;
-    float beta;
+    int alpha;
+    int beta;
     bool full;
+
+    SearchStats stats;
+};
+
+struct TimeManager {
+    /*
+    Decides when the search stops. The hard limit aborts the search mid iteration. On a clock,
+    the soft limit (optimum, scaled by how stable the search is) decides whether to start another iteration.
+    Without a limit (depth or infinite) neither applies.
+    */
+    TimeManager();
+    void init_clock(const Options&, const Position&, const double&, const double&, const int&);
+    void init_movetime(const Options&, const double&);
+    double elapsed() const;
+    bool out_of_time() const;
+    bool stop_iterating(const double&, const double&, const double&) const;
+    bool pondering() const;
+    bool out_of_nodes(const U64&) const;
+
+    double start;
+    double optimum;     // Target seconds for this move before scaling
+    double maximum;     // Hard limit in seconds
+    bool limited;       // Any time limit, hard or soft
+    bool use_soft;      // Playing on a clock, so iterations may stop early
+    const std::atomic<bool>* ponder;  // UCI ponder flag, no limit applies while it is set. nullptr if not pondering
+    U64 max_nodes;      // Node limit from go nodes, 0 if none
 };
 
 namespace Search {
-    constexpr float MAX = 10000;
-    constexpr float MIN = -10000;
+    constexpr char BOUND_EXACT = 0;
+    constexpr char BOUND_LOWER = 1;
+    constexpr char BOUND_UPPER = 2;
+
+    // Move ordering scores
+    constexpr int SCORE_HASH = 1000000;
+    constexpr int SCORE_CAPTURE = 100000;
+    constexpr int SCORE_KILLER1 = 90000;
+    constexpr int SCORE_KILLER2 = 80000;
+    constexpr int SCORE_COUNTER = 70000;
+    constexpr int SCORE_BAD_CAPTURE = -100000;
+    constexpr int HISTORY_MAX = 16384;   // History scores stay within +-HISTORY_MAX
+
+    constexpr int ASP_DEPTH = 4;     // Aspiration windows from this depth on
+    constexpr int ASP_WINDOW = 25;   // Initial half width, centipawns
+
+    constexpr int NMP_DEPTH = 3;         // Minimum depth for null move pruning
+    constexpr int NMP_VERIFY_DEPTH = 12; // Null move cutoffs are verified from this depth on
+
+    constexpr int IID_DEPTH = 4;         // Internal iterative deepening from this depth on (PV nodes)
+    constexpr int IIR_DEPTH = 4;         // Internal iterative reduction from this depth on (non-PV nodes)
+    constexpr int RFP_DEPTH = 7;         // Reverse futility pruning up to this depth
+    constexpr int RAZOR_DEPTH = 2;       // Razoring up to this depth
+    constexpr int FUTILITY_DEPTH = 3;    // Futility pruning up to this depth
+    constexpr int PROBCUT_DEPTH = 5;     // Minimum depth for ProbCut
+    constexpr int PROBCUT_MARGIN = 200;  // Raised beta for ProbCut, centipawns
+    constexpr int LMR_DEPTH = 3;         // Minimum depth for late move reductions
+    constexpr int LMP_DEPTH = 3;         // Late move pruning up to this depth
+
+    constexpr int SEE_PRUNE_DEPTH = 2;
+    constexpr int SEE_QUIET_MARGIN = 60;   // Centipawns per depth
 
-    constexpr float MATE_BOUND_MAX = MAX - 100;
-    constexpr float MATE_BOUND_MIN = MIN + 100;
+    constexpr int TIME_CHECK_NODES = 1024;  // Nodes between checks of the clock and stop flag
+    constexpr int TM_MOVES_LEFT = 40;       // Moves to plan for without movestogo
+    constexpr double TM_MAX_RATIO = 5;      // Hard limit as a multiple of the optimum
+    constexpr double TM_MAX_FRAC = 0.8;     // Never plan to use more than this fraction of the remaining time
 
-    float move_time(const Options&, const Position&, const float&, const float&);
+    void init();
 
-    SearchInfo search(const Options&, const Position&, const int&, const double&, const bool&,
-        bool&, const bool&);
+    SearchInfo search(const Options&, const Position&, const vector<U64>&, const int&, TimeManager&, const bool&,
+        const std::atomic<bool>&, ThreadData&, Progress* = nullptr);
+    SearchInfo search(const Options&, const Position&, const vector<U64>&, const int&, TimeManager&, const bool&,
+        const std::atomic<bool>&);
+    void report(Progress&);
 }
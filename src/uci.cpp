@@ -20,15 +20,21 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <chrono>
 #include <thread>
+#include <atomic>
 #include "utils.hpp"
 #include "bitboard.hpp"
 #include "search.hpp"
 #include "options.hpp"
 #include "eval.hpp"
 #include "perft.hpp"
+#include "mate.hpp"
 #include "hash.hpp"
 #include "endgame.hpp"
+#include "worker.hpp"
+#include "output.hpp"
 
 using std::cin;
 using std::cout;
@@ -43,32 +49,52 @@ const vector<string> LOSING = {"Oh no!", "I blundered.", "Nice play!", "Great jo
 const vector<string> GAME_END = {"Good game!", "I look forward to playing again.", "Want to play another one?", "Rematch?"};
 
 
-Position parse_pos(const string& str) {
+struct PositionCache {
+    /*
+    The position from the last position command. During a game each command repeats the previous
+    move list plus new moves, so only the new moves are played.
+    */
+    string base;            // "startpos" or the FEN
+    vector<string> moves;   // Moves played from base
+    Position pos;
+    vector<U64> history;    // Keys of the positions before pos, oldest first, for repetition detection
+};
+
+void parse_pos(const string& str, PositionCache& cache) {
     const vector<string> parts = split(str, " ");
+    string base;
+    Position start;
+    unsigned int first = parts.size();  // Index of the first move
     if (parts[1] == "startpos") {
-        Position pos = Bitboard::startpos();
-        if (parts.size() > 3 && parts[2] == "moves") {
-            for (UCH i = 3; i < parts.size(); i++) {
-                pos = Bitboard::push(pos, parts[i]);
-            }
-        }
-        return pos;
+        base = "startpos";
+        start = Bitboard::startpos();
+        if (parts.size() > 3 && parts[2] == "moves") first = 3;
     } else if (parts[1] == "fen") {
-        string fen;
         for (char i = 2; i < 8; i++) {
-            fen += parts[i];
-            fen += " ";
+            base += parts[i];
+            base += " ";
         }
-        Position pos = Bitboard::parse_fen(fen);
+        start = Bitboard::parse_fen(base);
+        if (parts.size() > 9 && parts[8] == "moves") first = 9;
+    }
 
-        if (parts.size() > 9 && parts[8] == "moves") {
-            for (UCH i = 9; i < parts.size(); i++) {
-                pos = Bitboard::push(pos, parts[i]);
-            }
-        }
-        return pos;
+    // Start over unless the move list extends the cached one from the same base.
+    bool extends = (base == cache.base) && (parts.size()-first >= cache.moves.size());
+    for (unsigned int i = 0; extends && (i < cache.moves.size()); i++) {
+        if (parts[first+i] != cache.moves[i]) extends = false;
+    }
+    if (!extends) {
+        cache.base = base;
+        cache.moves.clear();
+        cache.pos = start;
+        cache.history.clear();
+    }
+
+    for (unsigned int i = first + cache.moves.size(); i < parts.size(); i++) {
+        cache.history.push_back(Hash::hash(cache.pos));
+        cache.pos = Bitboard::push(cache.pos, parts[i]);
+        cache.moves.push_back(parts[i]);
     }
-    return Position();
 }
 
 
@@ -78,60 +104,62 @@ void print_legal_moves(const Position& pos) {
     for (const auto& m: moves) cout << Bitboard::move_str(m) << "\n";
 }
 
-void chat(const Options& options, const bool& turn, const int& movect, const float& score, const float& prev_score) {
+void chat(const Options& options, const bool& turn, const int& movect, const int& score, const int& prev_score) {
     return;  //! CHAT IS DISABLED
-    if (movect == 0) cout << "info string " << rand_choice(GREETINGS) << endl;
-    else if (turn  && (score > (prev_score+1.5))) cout << "info string " << rand_choice(WINNING) << endl;
-    else if (!turn && (score < (prev_score-1.5))) cout << "info string " << rand_choice(WINNING) << endl;
-    else if (turn  && (score < (prev_score-1.5))) cout << "info string " << rand_choice(LOSING)  << endl;
-    else if (!turn && (score > (prev_score+1.5))) cout << "info string " << rand_choice(LOSING)  << endl;
+    if (movect == 0) Output::line("info string " + rand_choice(GREETINGS));
+    else if (score > (prev_score+150)) Output::line("info string " + rand_choice(WINNING));
+    else if (score < (prev_score-150)) Output::line("info string " + rand_choice(LOSING));
 }
 
-float go(const Options& options, const Position& pos, const vector<string>& parts, const float& prev_eval, bool& searching) {
-    int mode = 0;
+int go(const Options& options, const Position& pos, const vector<U64>& history, const vector<string>& parts,
+        const int& prev_eval, const std::atomic<bool>& searching, const std::atomic<bool>& pondering, SearchStats& stats,
+        ThreadData& data, Progress& progress) {
+    TimeManager tm;     // Started now, so parsing counts against the clock
     int depth = 99;
-    double movetime;
-    float wtime = 0, btime = 0, winc = 0, binc = 0;
+    double wtime = -1, btime = -1, winc = 0, binc = 0, movetime = -1;
+    int movestogo = 0;
+    int mate = 0;
     bool infinite = false;
-    for (UCH i = 0; i < parts.size()-1; i++) {
-        if (parts[i] == "depth") {
-            mode = 1;
-            depth = std::stoi(parts[i+1]);
-        } else if (parts[i] == "wtime") {
-            mode = 2;
-            wtime = std::stof(parts[i+1]) / 1000;
-        } else if (parts[i] == "btime") {
-            mode = 2;
-            btime = std::stof(parts[i+1]) / 1000;
-        } else if (parts[i] == "winc") {
-            mode = 2;
-            winc = std::stof(parts[i+1]) / 1000;
-        } else if (parts[i] == "binc") {
-            mode = 2;
-            binc = std::stof(parts[i+1]) / 1000;
-        } else if (parts[i] == "movetime") {
-            mode = 3;
-            movetime = std::stof(parts[i+1]) / 1000;
-        } else if (parts[i] == "infinite") {
-            infinite = true;
-        }
+    for (unsigned int i = 0; i < parts.size(); i++) {
+        const bool has_value = (i+1 < parts.size());
+        if      (parts[i] == "depth"     && has_value) depth     = std::stoi(parts[i+1]);
+        else if (parts[i] == "wtime"     && has_value) wtime     = std::stod(parts[i+1]) / 1000;
+        else if (parts[i] == "btime"     && has_value) btime     = std::stod(parts[i+1]) / 1000;
+        else if (parts[i] == "winc"      && has_value) winc      = std::stod(parts[i+1]) / 1000;
+        else if (parts[i] == "binc"      && has_value) binc      = std::stod(parts[i+1]) / 1000;
+        else if (parts[i] == "movestogo" && has_value) movestogo = std::stoi(parts[i+1]);
+        else if (parts[i] == "movetime"  && has_value) movetime  = std::stod(parts[i+1]) / 1000;
+        else if (parts[i] == "nodes"     && has_value) tm.max_nodes = std::stoull(parts[i+1]);
+        else if (parts[i] == "mate"      && has_value) mate      = std::stoi(parts[i+1]);
+        else if (parts[i] == "infinite") infinite = true;
     }
 
-    if (mode == 0) {
-        depth = 99;
-        movetime = 10000000;  // About 100 days
-    } else if (mode == 1) {
-        movetime = 10000000;
-    } else if (mode == 2) {
-        depth = 99;
-        if (pos.turn) movetime = Search::move_time(options, pos, wtime, winc);
-        else          movetime = Search::move_time(options, pos, btime, binc);
+    const double time = pos.turn ? wtime : btime;
+    if (!infinite) {
+        if (movetime >= 0) tm.init_movetime(options, movetime);
+        else if (time >= 0) tm.init_clock(options, pos, time, pos.turn ? winc : binc, movestogo);
     }
-    if (mode == 2) movetime /= 1.5;
 
-    searching = true;
-    const SearchInfo result = Search::search(options, pos, depth, movetime, infinite, searching, (mode==2));
-    cout << "bestmove " << Bitboard::move_str(result.pv.front()) << endl;
+    tm.ponder = &pondering;
+
+    // go mate tries the checks-only mate search first, then a full search to the same depth.
+    SearchInfo result;
+    if (mate > 0) result = Mate::search(pos, mate, tm, searching);
+    if (result.pv.empty()) {
+        if (mate > 0) depth = std::min(depth, 2*mate-1);
+        // Progress lines come from the worker's reporter thread, the search only updates counters.
+        const bool report = (options.InfoInterval > 0);
+        if (report) progress.begin(&tm, options.InfoInterval);
+        result = Search::search(options, pos, history, depth, tm, infinite, searching, data, report ? &progress : nullptr);
+        if (report) progress.finish();
+    }
+    // bestmove may not be sent while pondering, even if the search is done.
+    while (searching && pondering) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    stats = result.stats;
+    string str = "bestmove " + Bitboard::move_str(result.pv.front());
+    if (result.pv.size() >= 2) str += " ponder " + Bitboard::move_str(result.pv[1]);
+    Output::line(str);
 
     chat(options, pos.turn, pos.move_cnt, result.score, prev_eval);
     return result.score;
@@ -172,37 +200,70 @@ void perft_push(const Position& pos, const int& knodes) {
     cout << "info nodes " << 1000*knodes << " nps " << (int)(knodes*1000/time) << " time " << (int)(time*1000) << endl;
 }
 
+void perft_see(const Position& pos, const int& knodes) {
+    const double time = Perft::see_perft(pos, knodes);
+    if (time < 0) {
+        cout << "info string no legal moves" << endl;
+        return;
+    }
+    cout << "info nodes " << 1000*knodes << " nps " << (int)(knodes*1000/time) << " time " << (int)(time*1000) << endl;
+}
+
 
 int loop() {
     string cmd;
     Options options;
-    Position pos = parse_pos("position startpos");
-    float prev_eval = 0;
-    bool searching = false;
+    PositionCache cache;
+    parse_pos("position startpos", cache);
+    Position& pos = cache.pos;
+    vector<U64>& history = cache.history;
+    int prev_eval = 0;
+    std::atomic<bool> searching(false);     // Cleared to stop the search
+    std::atomic<bool> pondering(false);
+    SearchStats stats;      // Of the last search, printed by the stats command
+    Worker worker;
+
+    // Options and the hash table only change between searches.
+    const auto stop_search = [&]() {
+        searching = false;
+        worker.wait();
+    };
 
     while (getline(cin, cmd)) {
         cmd = strip(cmd);
 
         if (cmd == "quit") break;
         else if (cmd == "clear") cout << "\x1b[3J\x1b[H\x1b[2J" << std::flush;
-        else if (cmd == "isready") cout << "readyok" << endl;
+        else if (cmd == "isready") Output::line("readyok");
         else if (cmd == "uci") {
-            cout << "id name Megalodon\n";
-            cout << "id author Megalodon Developers\n";
-
-            cout << "option name Hash type spin default 256 min 1 max 65536\n";
-
-            cout << "option name EvalMaterial type spin default 100 min 0 max 1000\n";
-            cout << "option name EvalPawnStruct type spin default 100 min 0 max 1000\n";
-            cout << "option name EvalSpace type spin default 100 min 0 max 1000\n";
-            cout << "option name EvalKnights type spin default 100 min 0 max 1000\n";
-            cout << "option name EvalRooks type spin default 100 min 0 max 1000\n";
-            cout << "option name EvalQueens type spin default 100 min 0 max 1000\n";
-            cout << "option name EvalKings type spin default 100 min 0 max 1000\n";
-
-            cout << "uciok" << endl;
+            Output::line("id name Megalodon");
+            Output::line("id author Megalodon Developers");
+
+            Output::line("option name Hash type spin default 256 min 1 max 65536");
+
+            Output::line("option name EvalMaterial type spin default 100 min 0 max 1000");
+            Output::line("option name EvalPawnStruct type spin default 100 min 0 max 1000");
+            Output::line("option name EvalSpace type spin default 100 min 0 max 1000");
+            Output::line("option name EvalKnights type spin default 100 min 0 max 1000");
+            Output::line("option name EvalRooks type spin default 100 min 0 max 1000");
+            Output::line("option name EvalQueens type spin default 100 min 0 max 1000");
+            Output::line("option name EvalKings type spin default 100 min 0 max 1000");
+
+            Output::line("option name RFPMargin type spin default 80 min 0 max 1000");
+            Output::line("option name FutilityMargin type spin default 120 min 0 max 1000");
+            Output::line("option name RazorMargin type spin default 300 min 0 max 2000");
+            Output::line("option name IID type check default true");
+            Output::line("option name IIR type check default true");
+
+            Output::line("option name MoveOverhead type spin default 30 min 0 max 5000");
+            Output::line("option name Ponder type check default false");
+            Output::line("option name MultiPV type spin default 1 min 1 max 256");
+            Output::line("option name InfoInterval type spin default 1000 min 0 max 60000");
+
+            Output::line("uciok");
         }
         else if (startswith(cmd, "setoption")) {
+            stop_search();
             const vector<string> parts = split(cmd, " ");
             const string name = parts[2];
             const string value = parts[4];
@@ -220,6 +281,17 @@ int loop() {
             else if (name == "EvalQueens")     options.EvalQueens     = std::stof(value)/100;
             else if (name == "EvalKings")      options.EvalKings      = std::stof(value)/100;
 
+            else if (name == "RFPMargin")      options.RFPMargin      = std::stoi(value);
+            else if (name == "FutilityMargin") options.FutilityMargin = std::stoi(value);
+            else if (name == "RazorMargin")    options.RazorMargin    = std::stoi(value);
+            else if (name == "IID")            options.IID            = (value == "true");
+            else if (name == "IIR")            options.IIR            = (value == "true");
+
+            else if (name == "MoveOverhead")   options.MoveOverhead   = std::stoi(value);
+            else if (name == "Ponder")         options.Ponder         = (value == "true");
+            else if (name == "MultiPV")        options.MultiPV        = std::stoi(value);
+            else if (name == "InfoInterval")   options.InfoInterval   = std::stoi(value);
+
             else std::cerr << "Unknown option: " << name << endl;
         }
 
@@ -246,27 +318,50 @@ int loop() {
             const vector<string> parts = split(cmd, " ");
             perft_push(pos, std::stoi(parts[1]));
         }
+        else if (startswith(cmd, "see")) {
+            const vector<string> parts = split(cmd, " ");
+            if (parts.size() == 1) {
+                for (const auto& move: Bitboard::legal_moves(pos, Bitboard::attacked(pos, !pos.turn))) {
+                    if (Bitboard::is_capture(pos, move)) cout << Bitboard::move_str(move) << ": " << Eval::see(pos, move) << "\n";
+                }
+                cout << std::flush;
+            } else if (parts[1] == "perft" && parts.size() >= 3) {
+                perft_see(pos, std::stoi(parts[2]));
+            }
+        }
         else if (cmd == "eg") cout << Endgame::eg_type(pos) << endl;
 
         else if (cmd == "ucinewgame") {
-            pos = parse_pos("position startpos");
+            stop_search();
+            parse_pos("position startpos", cache);
             prev_eval = 0;
+            options.clear_hash();
+            worker.data.clear();
         }
-        else if (startswith(cmd, "position")) pos = parse_pos(cmd);
+        else if (startswith(cmd, "position")) parse_pos(cmd, cache);
         else if (startswith(cmd, "go")) {
             const vector<string> parts = split(cmd, " ");
             if (parts.size() > 1 && parts[1] == "perft") perft(options, pos, std::stoi(parts[2]));
             else {
-                options.clear_hash();
+                stop_search();      // One search at a time, a go during a search ends it
                 searching = true;
-                std::thread(go, options, pos, parts, prev_eval, std::ref(searching)).detach();
+                pondering = std::find(parts.begin(), parts.end(), "ponder") != parts.end();
+                worker.run([&, options, pos, history, parts, prev_eval]() {
+                    go(options, pos, history, parts, prev_eval, searching, pondering, stats, worker.data, worker.progress);
+                });
             }
         }
         else if (cmd == "stop") searching = false;
+        else if (cmd == "ponderhit") pondering = false;    // Continue as a normal search on the same clock
+        else if (startswith(cmd, "debug")) options.debug = (cmd == "debug on");
+        else if (cmd == "stats") {
+            if (worker.busy()) Output::line("info string statistics are printed after the search");
+            else Output::line(stats.as_string());
+        }
         else if (cmd.size() > 0) std::cerr << "Unknown command: " << cmd << endl;
     }
 
-    searching = false;
+    stop_search();
     delete[] options.hash_table;
     return 0;
 }
@@ -34,9 +34,9 @@ using std::string;
 
 
 double get_time() {
-    const auto now = std::chrono::system_clock::now().time_since_epoch();
-    const double elapse = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
-    return elapse / 1000;
+    // Seconds on a monotonic clock, only meaningful as a difference.
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration<double>(now).count();
 }
 
 
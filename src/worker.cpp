@@ -0,0 +1,83 @@
+//
+//  Megalodon
+//  UCI chess engine
+//  Copyright the Megalodon developers
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "search.hpp"
+#include "worker.hpp"
+
+
+Worker::Worker() {
+    running = false;
+    quit = false;
+    reporter = std::thread(Search::report, std::ref(progress));
+    thread = std::thread(&Worker::loop, this);
+}
+
+Worker::~Worker() {
+    // Finishes the current job first, the caller stops it beforehand.
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    cv.notify_all();
+    thread.join();
+    progress.close();
+    reporter.join();
+}
+
+void Worker::run(const std::function<void()>& _job) {
+    // Starts a job once the previous one returned.
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]() { return !running; });
+    job = _job;
+    running = true;
+    cv.notify_all();
+}
+
+void Worker::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]() { return !running; });
+}
+
+bool Worker::busy() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return running;
+}
+
+void Worker::loop() {
+    while (true) {
+        std::function<void()> curr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return running || quit; });
+            if (!running) return;
+            curr = job;
+        }
+        curr();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+            job = nullptr;
+        }
+        cv.notify_all();
+    }
+}
@@ -0,0 +1,54 @@
+//
+//  Megalodon
+//  UCI chess engine
+//  Copyright the Megalodon developers
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "search.hpp"
+
+class Worker {
+/*
+Runs searches on one thread that lives as long as the UCI loop and sleeps between jobs.
+go hands it a job and returns, so the loop keeps answering stop, ponderhit and isready.
+The progress reporter thread and the search tables persist with it, a search only resets its own state.
+*/
+public:
+    Worker();
+    ~Worker();
+    void run(const std::function<void()>&);
+    void wait();
+    bool busy();
+
+    ThreadData data;        // Only touched by jobs, or by the loop while no job runs
+    Progress progress;
+
+private:
+    void loop();
+
+    std::thread reporter;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::function<void()> job;
+    bool running;   // A job was handed over and hasn't returned yet
+    bool quit;
+};
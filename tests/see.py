@@ -0,0 +1,62 @@
+#
+#  Megalodon
+#  UCI chess engine
+#  Copyright the Megalodon developers
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+# Checks static exchange evaluation against positions with known results.
+# Usage: python3 tests/see.py [engine path]
+
+import sys
+import subprocess
+
+ENG_PATH = "build/Megalodon"
+POSITIONS = (
+    # (FEN, move, expected centipawns)
+    ("4k3/8/8/3p4/4P3/8/8/4K3 w - - 0 1", "e4d5", 100),
+    ("rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2", "e4d5", 0),
+    ("4k3/8/4p3/3p4/8/8/8/3QK3 w - - 0 1", "d1d5", -800),
+    ("4k3/8/8/2pP4/8/8/8/4K3 w - c6 0 1", "d5c6", 100),
+    ("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5", 100),
+    # X-ray recaptures behind the first attackers
+    ("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5", -200),
+    ("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "e2e5", -400),
+)
+
+
+def engine_see(path, fen):
+    p = subprocess.run([path], input=f"position fen {fen}\nsee\nquit\n", capture_output=True, text=True)
+    results = {}
+    for line in p.stdout.split("\n"):
+        parts = line.split(": ")
+        if len(parts) == 2 and len(parts[0]) in (4, 5) and parts[1].lstrip("-").isnumeric():
+            results[parts[0]] = int(parts[1])
+    return results
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else ENG_PATH
+    failed = 0
+    for fen, move, expected in POSITIONS:
+        result = engine_see(path, fen).get(move)
+        if result != expected:
+            print(f"{fen} {move}: expected {expected}, got {result}")
+            failed += 1
+    print(f"{len(POSITIONS)-failed} of {len(POSITIONS)} correct")
+    return 1 if failed else 0
+
+
+exit(main())
@@ -0,0 +1,165 @@
+#
+#  Megalodon
+#  UCI chess engine
+#  Copyright the Megalodon developers
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+# Measures how long the engine takes to answer with bestmove after stop or after the movetime deadline.
+# One engine process is kept open like a GUI would, and every search goes through the real UCI pipe.
+# Writes one CSV row per search and prints a latency histogram.
+#
+# Usage: python3 tests/stop_latency.py [--engine build/Megalodon] [--movetime 50,100,250] [--rounds 2]
+#     [--csv stop_latency.csv] [--option Name=value ...]
+
+import os
+import sys
+import time
+import queue
+import argparse
+import threading
+import subprocess
+
+PARENT = os.path.dirname(os.path.realpath(__file__))
+ENG_PATH = "build/Megalodon"
+FENS = (
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r2q1rk1/ppp2pp1/2np1n1p/2b1p3/2B1P1b1/2NPBN2/PPPQ1PPP/R3R1K1 b - - 0 1",
+    "r2q1rk1/pbp1bpp1/1pn1pn1p/3p4/2PP3B/1PN1PN2/P3BPPP/R2Q1RK1 b - - 0 1",
+    "2k4r/1pp5/p7/2p1N3/3n1P2/7P/6P1/R5K1 b - - 0 1",
+    "r5k1/2p2ppp/pp2n3/8/P7/1B1P3P/1PP2PP1/3R1RK1 b - - 0 1",
+    "4k3/p7/Pp6/1Pp1p3/2PpPp1p/3P1PpP/6P1/3K4 w - - 0 1",
+    "8/kpP3p1/p2n2P1/3Q3P/5q2/P7/KP6/8 w - - 0 1",
+    "r1r1r1r1/k7/8/8/8/8/1K6/1R1R1R1R w - - 0 1",
+)
+BUCKETS = (1, 2, 5, 10, 20, 50, 100)   # Histogram upper bounds, milliseconds
+
+
+class Engine:
+    def __init__(self, path):
+        self.proc = subprocess.Popen([path], stdin=subprocess.PIPE, stdout=subprocess.PIPE, text=True, bufsize=1)
+        self.lines = queue.Queue()
+        threading.Thread(target=self.read, daemon=True).start()
+
+    def read(self):
+        # Timestamps each line as it arrives, so time spent in this script doesn't count.
+        for line in self.proc.stdout:
+            self.lines.put((time.perf_counter(), line.strip()))
+
+    def send(self, cmd):
+        self.proc.stdin.write(cmd + "\n")
+        self.proc.stdin.flush()
+        return time.perf_counter()
+
+    def wait_for(self, prefix):
+        while True:
+            stamp, line = self.lines.get()
+            if line.startswith(prefix):
+                return stamp
+
+    def sync(self):
+        self.send("isready")
+        self.wait_for("readyok")
+
+    def quit(self):
+        self.send("quit")
+        self.proc.wait()
+
+
+def measure(engine, fen, mode, movetime, overhead):
+    """
+    Returns (elapsed, latency), milliseconds.
+    movetime: the search should answer right at the deadline, latency is the time after it.
+        The engine keeps overhead (MoveOverhead) of the movetime in reserve, so the deadline is movetime-overhead.
+    stop: an infinite search is stopped after movetime, latency is the time from stop to bestmove.
+    """
+    engine.send(f"position fen {fen}")
+    engine.sync()
+    if mode == "movetime":
+        start = engine.send(f"go movetime {movetime}")
+        end = engine.wait_for("bestmove")
+        elapsed = 1000 * (end-start)
+        return (elapsed, elapsed - max(movetime-overhead, 0))
+
+    start = engine.send("go infinite")
+    time.sleep(movetime / 1000)
+    stop = engine.send("stop")
+    end = engine.wait_for("bestmove")
+    return (1000 * (end-start), 1000 * (end-stop))
+
+
+def histogram(latencies):
+    # Negative latencies (answered before the deadline) get their own bucket.
+    early = len([l for l in latencies if l < 0])
+    counts = [0] * (len(BUCKETS)+1)
+    for latency in latencies:
+        if latency < 0:
+            continue
+        i = 0
+        while i < len(BUCKETS) and latency > BUCKETS[i]:
+            i += 1
+        counts[i] += 1
+
+    print(f"  {'early':>12}: {early}")
+    lower = 0
+    for i, count in enumerate(counts):
+        label = f"{lower}-{BUCKETS[i]} ms" if i < len(BUCKETS) else f">{lower} ms"
+        print(f"  {label:>12}: {count}")
+        if i < len(BUCKETS):
+            lower = BUCKETS[i]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Stop latency and time overshoot harness.")
+    parser.add_argument("--engine", default=ENG_PATH)
+    parser.add_argument("--movetime", default="50,100,250", help="comma separated milliseconds")
+    parser.add_argument("--rounds", type=int, default=2, help="searches per position, mode and movetime")
+    parser.add_argument("--csv", default="stop_latency.csv")
+    parser.add_argument("--option", action="append", default=[], help="UCI option as Name=value, repeatable")
+    args = parser.parse_args()
+    movetimes = [int(t) for t in args.movetime.split(",")]
+
+    engine = Engine(args.engine)
+    engine.send("uci")
+    engine.wait_for("uciok")
+    # No reserved overhead unless asked for, so the deadline is the movetime itself.
+    overhead = 0
+    for option in ["MoveOverhead=0"] + args.option:
+        name, value = option.split("=", 1)
+        engine.send(f"setoption name {name} value {value}")
+        if name == "MoveOverhead":
+            overhead = int(value)
+
+    results = {"movetime": [], "stop": []}
+    with open(args.csv, "w") as file:
+        file.write("mode,position,movetime,elapsed,latency\n")
+        for movetime in movetimes:
+            for mode in results:
+                for i, fen in enumerate(FENS):
+                    for _ in range(args.rounds):
+                        elapsed, latency = measure(engine, fen, mode, movetime, overhead)
+                        results[mode].append(latency)
+                        file.write(f"{mode},{i},{movetime},{elapsed:.3f},{latency:.3f}\n")
+    engine.quit()
+
+    for mode, latencies in results.items():
+        latencies.sort()
+        print(f"{mode}: {len(latencies)} searches, median {latencies[len(latencies)//2]:.2f} ms, "
+              f"p99 {latencies[min(len(latencies)-1, len(latencies)*99//100)]:.2f} ms, max {latencies[-1]:.2f} ms")
+        histogram(latencies)
+    print(f"Results written to {args.csv}")
+
+
+main()